@@ -7,4 +7,5 @@
 #include <binary/algorithm/experimental.hpp>
 #include <binary/algorithm/interval_tree.hpp>
 #include <binary/algorithm/rb_tree.hpp>
+#include <binary/algorithm/static_interval_index.hpp>
 #endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_ALGORITHM_ALL_HPP_
@@ -9,10 +9,16 @@
 #include <spdlog/spdlog.h>
 
 #include <binary/algorithm/rb_tree.hpp>
+#include <array>
 #include <binary/concepts.hpp>
+#include <cassert>
+#include <concepts>
 #include <future>
+#include <iterator>
 #include <optional>
 #include <ranges>
+#include <type_traits>
+#include <vector>
 namespace binary::algorithm::tree {
 
   /** Interval Tree Based on Red Black Tree
@@ -131,6 +137,25 @@ namespace binary::algorithm::tree {
     key_type high{};
   };
 
+  namespace details {
+    /**
+     * @brief call visitor of overlap queries, which may return false to stop the query
+     * @return false if the query should stop
+     */
+    template <typename Visitor, typename Interval>
+    auto visit_interval(Visitor &visit, Interval const &interval) -> bool {
+      if constexpr (std::same_as<std::invoke_result_t<Visitor &, Interval const &>, void>) {
+        visit(interval);
+        return true;
+      } else {
+        return static_cast<bool>(visit(interval));
+      }
+    }
+  }  // namespace details
+
+  template <typename Visitor, typename Interval>
+  concept OverlapVisitor = std::invocable<Visitor &, Interval const &>;
+
   // set template alias for interval
   using IntInterval = BaseInterval<std::int32_t>;
   using UIntInterval = BaseInterval<std::uint32_t>;
@@ -161,6 +186,24 @@ namespace binary::algorithm::tree {
     [[nodiscard]] auto find_overlaps(std::same_as<interval_type> auto &&interval) const
         -> std::vector<interval_type>;
 
+    /**
+     * @brief write overlapping intervals to out in the order of low
+     */
+    template <std::weakly_incrementable Out>
+    requires std::indirectly_writable<Out, interval_type const &>
+    auto find_overlaps(interval_type const &interval, Out out) const -> Out {
+      visit_overlaps(interval, [&out](interval_type const &overlap) { *out++ = overlap; });
+      return out;
+    }
+
+    /**
+     * @brief call visit with every overlapping interval in the order of low, intervals are
+     * passed by reference and not copied
+     * @param visit returns void, or false to stop the query
+     */
+    template <OverlapVisitor<interval_type> Visitor>
+    void visit_overlaps(interval_type const &interval, Visitor &&visit) const;
+
     template <typename... Args>
     requires binary::concepts::ArgsConstructible<interval_type, Args...>
     [[nodiscard]] auto find_overlaps(Args &&...args) const -> std::vector<interval_type> {
@@ -168,8 +211,8 @@ namespace binary::algorithm::tree {
     }
 
   private:
-    auto find_overlaps_impl(interval_type const &interval, raw_pointer node) const
-        -> std::vector<interval_type>;
+    // height of a red black tree is at most 2 * log2(n + 1)
+    static constexpr std::size_t MAX_HEIGHT = 2 * sizeof(std::size_t) * 8;
 
     void to_dot_impl(std::ofstream &output, raw_pointer node) const override;
     void left_rotate(raw_pointer node) override;
@@ -184,6 +227,7 @@ namespace binary::algorithm::tree {
 
     using RbTree<NodeType>::root_;
     using RbTree<NodeType>::nil_;
+    using RbTree<NodeType>::inorder_for_each;
   };
 
   template <IntervalNodeConcept NodeType>
@@ -279,12 +323,10 @@ namespace binary::algorithm::tree {
 
   template <IntervalNodeConcept NodeType>
   void IntervalTree<NodeType>::inorder_walk(raw_pointer node, int indent) const {
-    if (node != nullptr) {
-      inorder_walk(node->leftr(), indent);
-      fmt::print("{:{}}-{} is_black:{} max:{} \n", node->key, indent, node->interval.high,
-                 node->is_black(), node->max);
-      inorder_walk(node->rightr(), indent);
-    }
+    inorder_for_each(node, [indent](raw_pointer current) {
+      fmt::print("{:{}}-{} is_black:{} max:{} \n", current->key, indent, current->interval.high,
+                 current->is_black(), current->max);
+    });
   }
 
   template <IntervalNodeConcept NodeType>
@@ -304,33 +346,38 @@ namespace binary::algorithm::tree {
   }
 
   template <IntervalNodeConcept NodeType>
-  auto IntervalTree<NodeType>::find_overlaps_impl(interval_type const &interval,
-                                                  raw_pointer node) const
-      -> std::vector<interval_type> {
-    std::vector<interval_type> ret{};
-    if (node == nullptr) {
-      return ret;
-    }
-
-    if (interval.is_overlap(node->interval)) {
-      ret.push_back(node->interval);
-    }
+  template <OverlapVisitor<typename NodeType::interval_type> Visitor>
+  void IntervalTree<NodeType>::visit_overlaps(interval_type const &interval,
+                                              Visitor &&visit) const {
+    // in-order walk with an explicit stack, subtrees which can not overlap are skipped
+    auto stack = std::array<raw_pointer, MAX_HEIGHT>{};
+    std::size_t top = 0;
+    raw_pointer node = root_.get();
+
+    while (node != nullptr || top > 0) {
+      while (node != nullptr) {
+        assert(top < MAX_HEIGHT);
+        stack[top++] = node;
+        node = interval.low <= get_max(node->leftr()) ? node->leftr() : nullptr;
+      }
 
-    if (interval.low <= get_max(node->leftr())) {
-      std::ranges::move(find_overlaps_impl(interval, node->leftr()), std::back_inserter(ret));
-    }
+      node = stack[--top];
+      if (interval.is_overlap(node->interval) && !details::visit_interval(visit, node->interval)) {
+        return;
+      }
 
-    if (interval.high >= node->key && interval.low <= get_max(node->rightr())) {
-      std::ranges::move(find_overlaps_impl(interval, node->rightr()), std::back_inserter(ret));
+      node = interval.high >= node->key && interval.low <= get_max(node->rightr())
+                 ? node->rightr()
+                 : nullptr;
     }
-
-    return ret;
   }
 
   template <IntervalNodeConcept NodeType>
   auto IntervalTree<NodeType>::find_overlaps(std::same_as<interval_type> auto &&interval) const
       -> std::vector<interval_type> {
-    return find_overlaps_impl(std::forward<interval_type>(interval), root_.get());
+    std::vector<interval_type> ret{};
+    find_overlaps(interval, std::back_inserter(ret));
+    return ret;
   }
 
 }  // namespace binary::algorithm::tree
@@ -8,11 +8,15 @@
 
 #include <cassert>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <ranges>
+#include <type_traits>
+#include <utility>
 
 namespace binary::algorithm::tree {
 
@@ -100,9 +104,55 @@ namespace binary::algorithm::tree {
     using reference_pointer = typename NodeType::reference_pointer;
     using raw_pointer = typename NodeType::raw_pointer;
 
+    /**
+     * @brief in-order iterator, which follows parent pointers and needs no stack
+     */
+    class const_iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::remove_pointer_t<raw_pointer>;
+      using difference_type = std::ptrdiff_t;
+      using reference = value_type const &;
+
+      constexpr const_iterator() = default;
+
+      auto operator*() const -> reference { return *node_; }
+      auto operator->() const -> value_type const * { return node_; }
+
+      auto operator++() -> const_iterator & {
+        node_ = tree_->successor(node_);
+        return *this;
+      }
+
+      auto operator++(int) -> const_iterator {
+        auto temp = *this;
+        ++*this;
+        return temp;
+      }
+
+      friend auto operator==(const_iterator const &lhs, const_iterator const &rhs) -> bool {
+        return lhs.node_ == rhs.node_;
+      }
+
+    private:
+      friend class RbTree;
+      const_iterator(RbTree const *tree, raw_pointer node) : tree_{tree}, node_{node} {}
+
+      RbTree const *tree_{nullptr};
+      raw_pointer node_{nullptr};
+    };
+
     constexpr RbTree() = default;
-    constexpr RbTree(RbTree &&other) noexcept = default;
-    auto operator=(RbTree &&other) noexcept -> RbTree & = default;
+    RbTree(RbTree &&other) noexcept
+        : root_{std::move(other.root_)},
+          nil_{std::move(other.nil_)},
+          size_{std::exchange(other.size_, 0)} {}
+    auto operator=(RbTree &&other) noexcept -> RbTree & {
+      root_ = std::move(other.root_);
+      nil_ = std::move(other.nil_);
+      size_ = std::exchange(other.size_, 0);
+      return *this;
+    }
     constexpr RbTree(const RbTree &other) = delete;
     auto operator=(const RbTree &other) -> RbTree & = delete;
 
@@ -124,10 +174,39 @@ namespace binary::algorithm::tree {
      * @return
      */
     [[nodiscard]] auto empty() const -> bool;
+    /**
+     * @brief number of nodes in the subtree of node, counted without recursion
+     */
     [[nodiscard]] auto size(raw_pointer node) const -> size_t;
+    /**
+     * @brief number of nodes, kept by insert and delete
+     */
     [[nodiscard]] auto size() const -> size_t;
     [[nodiscard]] auto root() const -> raw_pointer;
 
+    [[nodiscard]] auto begin() const -> const_iterator;
+    [[nodiscard]] auto end() const -> const_iterator { return {this, nullptr}; }
+
+    /**
+     * @return first node whose key is not less than key
+     */
+    [[nodiscard]] auto lower_bound(typename NodeType::key_type const &key) const
+        -> const_iterator;
+    /**
+     * @return first node whose key is greater than key
+     */
+    [[nodiscard]] auto upper_bound(typename NodeType::key_type const &key) const
+        -> const_iterator;
+
+    /**
+     * @brief nodes whose key is in [low, high] in order
+     */
+    [[nodiscard]] auto range(typename NodeType::key_type const &low,
+                             typename NodeType::key_type const &high) const
+        -> std::ranges::subrange<const_iterator> {
+      return {lower_bound(low), upper_bound(high)};
+    }
+
     // WARNING: Return raw pointer do not delete that!
     [[nodiscard]] auto minimum(raw_pointer node) const -> raw_pointer;
     [[nodiscard]] auto maximum(raw_pointer node) const -> raw_pointer;
@@ -166,21 +245,69 @@ namespace binary::algorithm::tree {
     [[nodiscard]] auto check_is_black(raw_pointer node) const -> bool;
     void release_reset(reference_pointer target, raw_pointer source = nullptr) const;
 
+    /**
+     * @brief call visit with every node of the subtree of node in order
+     */
+    template <typename Visitor> void inorder_for_each(raw_pointer node, Visitor &&visit) const {
+      if (node == nullptr) return;
+      // the successor of the maximum is the first node after the subtree
+      auto last = successor(maximum(node));
+      for (auto current = minimum(node); current != last; current = successor(current)) {
+        visit(current);
+      }
+    }
+
     pointer root_{nullptr};
     pointer nil_{std::make_unique<NodeType>()};  // only for delete and tree is always owner
+    std::size_t size_{0};
   };
 
-  template <NodeConcept NodeType> auto RbTree<NodeType>::size() const -> size_t {
-    return size(root_.get());
-  }
+  template <NodeConcept NodeType> auto RbTree<NodeType>::size() const -> size_t { return size_; }
 
   template <NodeConcept NodeType> auto RbTree<NodeType>::size(raw_pointer node) const -> size_t {
-    if (node == nullptr) return 0;
-    return 1 + size(node->leftr()) + size(node->rightr());
+    if (node == root_.get()) return size_;
+
+    size_t count = 0;
+    inorder_for_each(node, [&count](raw_pointer) { ++count; });
+    return count;
   }
 
   template <NodeConcept NodeType> auto RbTree<NodeType>::empty() const -> bool {
-    return size() == 0;
+    return root_ == nullptr;
+  }
+
+  template <NodeConcept NodeType> auto RbTree<NodeType>::begin() const -> const_iterator {
+    return {this, root_ == nullptr ? nullptr : minimum(root_.get())};
+  }
+
+  template <NodeConcept NodeType>
+  auto RbTree<NodeType>::lower_bound(typename NodeType::key_type const &key) const
+      -> const_iterator {
+    raw_pointer found = nullptr;
+    for (raw_pointer node = root_.get(); node != nullptr;) {
+      if (node->key < key) {
+        node = node->rightr();
+      } else {
+        found = node;
+        node = node->leftr();
+      }
+    }
+    return {this, found};
+  }
+
+  template <NodeConcept NodeType>
+  auto RbTree<NodeType>::upper_bound(typename NodeType::key_type const &key) const
+      -> const_iterator {
+    raw_pointer found = nullptr;
+    for (raw_pointer node = root_.get(); node != nullptr;) {
+      if (key < node->key) {
+        found = node;
+        node = node->leftr();
+      } else {
+        node = node->rightr();
+      }
+    }
+    return {this, found};
   }
 
   template <NodeConcept NodeType> auto RbTree<NodeType>::root() const -> raw_pointer {
@@ -372,15 +499,14 @@ namespace binary::algorithm::tree {
   template <NodeConcept NodeType>
   [[maybe_unused]] void RbTree<NodeType>::insert_node(pointer node) {
     insert_node_impl(node.release());
+    ++size_;
   }
 
   template <NodeConcept NodeType>
   void RbTree<NodeType>::inorder_walk(raw_pointer node, int indent) const {
-    if (node != nullptr) {
-      inorder_walk(node->leftr(), indent);
-      fmt::print("{:{}} is_black {} \n", node->key, indent + 4, node->is_black());
-      inorder_walk(node->rightr(), indent);
-    }
+    inorder_for_each(node, [indent](raw_pointer current) {
+      fmt::print("{:{}} is_black {} \n", current->key, indent + 4, current->is_black());
+    });
   }
 
   template <NodeConcept NodeType>
@@ -505,6 +631,7 @@ namespace binary::algorithm::tree {
 
   template <NodeConcept NodeType> void RbTree<NodeType>::delete_node(raw_pointer node) {
     if (node == nullptr) return;
+    --size_;
 
     raw_pointer y = node;
     raw_pointer x{nullptr};
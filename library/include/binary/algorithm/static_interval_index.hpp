@@ -0,0 +1,390 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_ALGORITHM_STATIC_INTERVAL_INDEX_HPP_
+#define BUILDALL_LIBRARY_INCLUDE_BINARY_ALGORITHM_STATIC_INTERVAL_INDEX_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <binary/algorithm/interval_tree.hpp>
+#include <binary/concepts.hpp>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace binary::algorithm::tree {
+
+  namespace details {
+    // chunks for every thread, more chunks balance the work of threads better
+    constexpr std::size_t CHUNKS_PER_THREAD = 16;
+
+    inline auto resolve_threads(std::size_t num_threads) -> std::size_t {
+      if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+      return std::max<std::size_t>(num_threads, 1);
+    }
+
+    inline auto parallel_chunk_size(std::size_t size, std::size_t num_threads) -> std::size_t {
+      return std::max<std::size_t>(size / (num_threads * CHUNKS_PER_THREAD), 1);
+    }
+
+    /**
+     * @brief call work(chunk, begin, end) for chunks of [0, size) on threads which take the
+     * next chunk from a shared counter when they are done, the calling thread works as well
+     * @throws the first exception thrown by work, after all threads stop
+     */
+    template <typename Work>
+    void parallel_for_chunks(std::size_t size, std::size_t chunk_size, std::size_t num_threads,
+                             Work &&work) {
+      auto const num_chunks = (size + chunk_size - 1) / chunk_size;
+      auto next_chunk = std::atomic<std::size_t>{0};
+      auto error = std::exception_ptr{};
+      auto error_mutex = std::mutex{};
+
+      auto run = [&] {
+        for (auto chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+          try {
+            work(chunk, chunk * chunk_size, std::min(size, (chunk + 1) * chunk_size));
+          } catch (...) {
+            std::lock_guard lock{error_mutex};
+            if (!error) error = std::current_exception();
+            next_chunk = num_chunks;
+          }
+        }
+      };
+
+      {
+        auto threads = std::vector<std::jthread>{};
+        for (std::size_t i = 1; i < std::min(num_threads, num_chunks); ++i) {
+          threads.emplace_back(run);
+        }
+        run();
+      }
+      if (error) std::rethrow_exception(error);
+    }
+  }  // namespace details
+
+  /** Static Interval Index
+
+  Intervals are sorted by low once and never modified. The sorted array is the in-order
+  layout of an implicit balanced tree, as in cgranges:
+
+  1. Leaves are at even indexes, nodes of level k have k trailing ones in their index
+  2. Children of node i at level k are i - 2^(k-1) and i + 2^(k-1)
+  3. Every node keeps the max high of its subtree, nodes past the end are virtual
+
+  Building is one sort and one linear pass, queries touch two contiguous arrays.
+  **/
+
+  template <IntervalConcept Interval> class StaticIntervalIndex {
+  public:
+    using interval_type = Interval;
+    using key_type = typename Interval::key_type;
+
+    constexpr StaticIntervalIndex() = default;
+
+    /**
+     * @brief build index from intervals or values intervals are constructed from
+     */
+    template <std::ranges::input_range R>
+    requires std::constructible_from<interval_type, std::ranges::range_reference_t<R>>
+    explicit StaticIntervalIndex(R &&range) {
+      if constexpr (std::ranges::sized_range<R>) intervals_.reserve(std::ranges::size(range));
+      for (auto &&item : range) intervals_.emplace_back(std::forward<decltype(item)>(item));
+      build();
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return intervals_.size(); }
+    [[nodiscard]] auto empty() const noexcept -> bool { return intervals_.empty(); }
+
+    /**
+     * @brief intervals sorted by low, intervals with the same low keep their input order
+     */
+    [[nodiscard]] auto intervals() const noexcept -> std::vector<interval_type> const & {
+      return intervals_;
+    }
+
+    [[nodiscard]] auto find_overlap(interval_type const &interval) const
+        -> std::optional<interval_type>;
+
+    template <typename... Args>
+    requires binary::concepts::ArgsConstructible<interval_type, Args...>
+    [[nodiscard]] auto find_overlap(Args &&...args) const -> std::optional<interval_type> {
+      return find_overlap(interval_type{std::forward<Args>(args)...});
+    }
+
+    /**
+     * @return overlapping intervals in the order of low
+     */
+    [[nodiscard]] auto find_overlaps(interval_type const &interval) const
+        -> std::vector<interval_type>;
+
+    template <typename... Args>
+    requires binary::concepts::ArgsConstructible<interval_type, Args...>
+    [[nodiscard]] auto find_overlaps(Args &&...args) const -> std::vector<interval_type> {
+      return find_overlaps(interval_type{std::forward<Args>(args)...});
+    }
+
+    /**
+     * @brief write overlapping intervals to out in the order of low
+     */
+    template <std::weakly_incrementable Out>
+    requires std::indirectly_writable<Out, interval_type const &>
+    auto find_overlaps(interval_type const &interval, Out out) const -> Out {
+      visit_overlaps(interval, [&out](interval_type const &overlap) { *out++ = overlap; });
+      return out;
+    }
+
+    /**
+     * @brief call visit with every overlapping interval in the order of low, intervals are
+     * passed by reference and not copied
+     * @param visit returns void, or false to stop the query
+     */
+    template <OverlapVisitor<interval_type> Visitor>
+    void visit_overlaps(interval_type const &interval, Visitor &&visit) const;
+
+    /**
+     * @brief join queries sorted by low against the index in one sweep
+     *
+     * Intervals enter the sweep once and leave it when they end before the current query, so
+     * a query only scans its own overlaps instead of searching from the root. Queries out of
+     * order are answered by visit_overlaps and do not break the sweep.
+     * @param visit called with the position of a query in queries and an overlapping interval,
+     * in the order of queries and then of low, the same pairs as visit_overlaps
+     */
+    template <std::ranges::input_range Queries, typename Visitor>
+    requires std::same_as<std::ranges::range_value_t<Queries>, interval_type>
+             && std::invocable<Visitor &, std::size_t, interval_type const &>
+    void sweep_overlaps(Queries &&queries, Visitor &&visit) const;
+
+    /**
+     * @brief sweep_overlaps on threads sharing the index, which is never modified
+     *
+     * Queries are split into chunks that threads take when they are done with the last one.
+     * visit is called concurrently, pairs of one query are visited by one thread in order.
+     * @param num_threads 0 for all cores
+     */
+    template <std::ranges::random_access_range Queries, typename Visitor>
+    requires std::ranges::sized_range<Queries>
+             && std::same_as<std::ranges::range_value_t<Queries>, interval_type>
+             && std::invocable<Visitor &, std::size_t, interval_type const &>
+    void parallel_visit_overlaps(Queries const &queries, Visitor &&visit,
+                                 std::size_t num_threads = 0) const;
+
+    /**
+     * @brief find overlaps of many queries on threads sharing the index
+     *
+     * Every chunk of queries is swept into its own buffer, buffers are concatenated in the
+     * order of chunks at the end.
+     * @param num_threads 0 for all cores
+     * @return pairs of position of query and overlapping interval, in the order of queries
+     */
+    template <std::ranges::random_access_range Queries>
+    requires std::ranges::sized_range<Queries>
+             && std::same_as<std::ranges::range_value_t<Queries>, interval_type>
+    [[nodiscard]] auto parallel_find_overlaps(Queries const &queries,
+                                              std::size_t num_threads = 0) const
+        -> std::vector<std::pair<std::size_t, interval_type>>;
+
+  private:
+    // subtrees of this level or lower are scanned linearly
+    static constexpr int SCAN_LEVEL = 3;
+
+    struct StackItem {
+      int level{};
+      std::size_t index{};
+      bool left_done{};
+    };
+
+    void build();
+
+    std::vector<interval_type> intervals_{};
+    std::vector<key_type> max_{};
+    int max_level_{-1};
+  };
+
+  template <IntervalConcept Interval> void StaticIntervalIndex<Interval>::build() {
+    std::ranges::stable_sort(intervals_, {}, &interval_type::low);
+
+    auto const n = intervals_.size();
+    max_.resize(n);
+    if (n == 0) {
+      max_level_ = -1;
+      return;
+    }
+
+    // max of the rightmost subtree of the current level, which may miss nodes past the end
+    std::size_t last_index = 0;
+    key_type last_max{};
+    for (std::size_t i = 0; i < n; i += 2) {
+      last_index = i;
+      last_max = max_[i] = intervals_[i].high;
+    }
+
+    int level = 1;
+    for (; (std::size_t{1} << level) <= n; ++level) {
+      auto const half = std::size_t{1} << (level - 1);
+      for (auto i = (half << 1) - 1; i < n; i += half << 2) {
+        auto left_max = max_[i - half];
+        auto right_max = i + half < n ? max_[i + half] : last_max;
+        max_[i] = std::max({intervals_[i].high, left_max, right_max});
+      }
+      last_index = ((last_index >> level) & 1U) != 0 ? last_index - half : last_index + half;
+      if (last_index < n) last_max = std::max(last_max, max_[last_index]);
+    }
+    max_level_ = level - 1;
+  }
+
+  template <IntervalConcept Interval>
+  template <OverlapVisitor<Interval> Visitor>
+  void StaticIntervalIndex<Interval>::visit_overlaps(interval_type const &interval,
+                                                     Visitor &&visit) const {
+    if (max_level_ < 0) return;
+
+    auto const n = intervals_.size();
+    // depth of the implicit tree is bounded by the bits of size_t
+    auto stack = std::array<StackItem, 2 * sizeof(std::size_t) * 8>{};
+    std::size_t top = 0;
+    stack[top++] = {max_level_, (std::size_t{1} << max_level_) - 1, false};
+
+    while (top > 0) {
+      auto item = stack[--top];
+      if (item.level <= SCAN_LEVEL) {
+        auto begin = item.index >> item.level << item.level;
+        auto end = std::min(begin + (std::size_t{1} << (item.level + 1)) - 1, n);
+        for (auto i = begin; i < end && intervals_[i].low <= interval.high; ++i) {
+          auto const &overlap = intervals_[i];
+          if (interval.is_overlap(overlap) && !details::visit_interval(visit, overlap)) return;
+        }
+      } else if (!item.left_done) {
+        auto left = item.index - (std::size_t{1} << (item.level - 1));
+        stack[top++] = {item.level, item.index, true};
+        // nodes past the end only have left children
+        if (left >= n || max_[left] >= interval.low) stack[top++] = {item.level - 1, left, false};
+      } else if (item.index < n && intervals_[item.index].low <= interval.high) {
+        auto const &overlap = intervals_[item.index];
+        if (interval.is_overlap(overlap) && !details::visit_interval(visit, overlap)) return;
+        stack[top++]
+            = {item.level - 1, item.index + (std::size_t{1} << (item.level - 1)), false};
+      }
+    }
+  }
+
+  template <IntervalConcept Interval>
+  template <std::ranges::input_range Queries, typename Visitor>
+  requires std::same_as<std::ranges::range_value_t<Queries>, Interval>
+           && std::invocable<Visitor &, std::size_t, Interval const &>
+  void StaticIntervalIndex<Interval>::sweep_overlaps(Queries &&queries, Visitor &&visit) const {
+    auto const n = intervals_.size();
+    // intervals before next which may still overlap, in the order of low
+    auto active = std::vector<std::size_t>{};
+    std::size_t next = 0;
+    auto last_low = std::optional<key_type>{};
+    std::size_t position = 0;
+
+    for (auto const &query : queries) {
+      auto const query_position = position++;
+      if (last_low.has_value() && query.low < *last_low) {
+        visit_overlaps(query,
+                       [&](interval_type const &overlap) { visit(query_position, overlap); });
+        continue;
+      }
+      last_low = query.low;
+
+      // lows of later queries are not smaller, intervals ending before this one never overlap
+      for (; next < n && intervals_[next].low < query.low; ++next) {
+        if (intervals_[next].high >= query.low) active.push_back(next);
+      }
+      std::erase_if(active, [&](std::size_t index) { return intervals_[index].high < query.low; });
+
+      for (auto index : active) {
+        if (query.is_overlap(intervals_[index])) visit(query_position, intervals_[index]);
+      }
+      for (auto index = next; index < n && intervals_[index].low <= query.high; ++index) {
+        if (query.is_overlap(intervals_[index])) visit(query_position, intervals_[index]);
+      }
+    }
+  }
+
+  template <IntervalConcept Interval>
+  template <std::ranges::random_access_range Queries, typename Visitor>
+  requires std::ranges::sized_range<Queries>
+           && std::same_as<std::ranges::range_value_t<Queries>, Interval>
+           && std::invocable<Visitor &, std::size_t, Interval const &>
+  void StaticIntervalIndex<Interval>::parallel_visit_overlaps(Queries const &queries,
+                                                              Visitor &&visit,
+                                                              std::size_t num_threads) const {
+    auto const size = static_cast<std::size_t>(std::ranges::size(queries));
+    num_threads = details::resolve_threads(num_threads);
+
+    details::parallel_for_chunks(
+        size, details::parallel_chunk_size(size, num_threads), num_threads,
+        [&](std::size_t, std::size_t begin, std::size_t end) {
+          auto first = std::ranges::begin(queries);
+          sweep_overlaps(std::ranges::subrange(first + begin, first + end),
+                         [&](std::size_t position, interval_type const &overlap) {
+                           visit(begin + position, overlap);
+                         });
+        });
+  }
+
+  template <IntervalConcept Interval>
+  template <std::ranges::random_access_range Queries>
+  requires std::ranges::sized_range<Queries>
+           && std::same_as<std::ranges::range_value_t<Queries>, Interval>
+  auto StaticIntervalIndex<Interval>::parallel_find_overlaps(Queries const &queries,
+                                                             std::size_t num_threads) const
+      -> std::vector<std::pair<std::size_t, interval_type>> {
+    using result_type = std::vector<std::pair<std::size_t, interval_type>>;
+    auto const size = static_cast<std::size_t>(std::ranges::size(queries));
+    num_threads = details::resolve_threads(num_threads);
+    auto const chunk_size = details::parallel_chunk_size(size, num_threads);
+
+    auto buffers = std::vector<result_type>((size + chunk_size - 1) / chunk_size);
+    details::parallel_for_chunks(
+        size, chunk_size, num_threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+          auto first = std::ranges::begin(queries);
+          sweep_overlaps(std::ranges::subrange(first + begin, first + end),
+                         [&](std::size_t position, interval_type const &overlap) {
+                           buffers[chunk].emplace_back(begin + position, overlap);
+                         });
+        });
+
+    auto total = std::size_t{0};
+    for (auto const &buffer : buffers) total += buffer.size();
+
+    auto ret = result_type{};
+    ret.reserve(total);
+    for (auto &buffer : buffers) std::ranges::move(buffer, std::back_inserter(ret));
+    return ret;
+  }
+
+  template <IntervalConcept Interval>
+  auto StaticIntervalIndex<Interval>::find_overlap(interval_type const &interval) const
+      -> std::optional<interval_type> {
+    auto found = std::optional<interval_type>{};
+    visit_overlaps(interval, [&found](interval_type const &overlap) {
+      found = overlap;
+      return false;
+    });
+    return found;
+  }
+
+  template <IntervalConcept Interval>
+  auto StaticIntervalIndex<Interval>::find_overlaps(interval_type const &interval) const
+      -> std::vector<interval_type> {
+    std::vector<interval_type> ret{};
+    find_overlaps(interval, std::back_inserter(ret));
+    return ret;
+  }
+
+}  // namespace binary::algorithm::tree
+
+#endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_ALGORITHM_STATIC_INTERVAL_INDEX_HPP_
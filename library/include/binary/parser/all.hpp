@@ -4,5 +4,9 @@
 
 #ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_ALL_HPP_
 #define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_ALL_HPP_
+#include <binary/parser/contig.hpp>
+#include <binary/parser/info_schema.hpp>
 #include <binary/parser/vcf.hpp>
+#include <binary/parser/vcf_batch.hpp>
+#include <binary/parser/vcf_text.hpp>
 #endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_ALL_HPP_
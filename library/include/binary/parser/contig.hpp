@@ -0,0 +1,90 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_CONTIG_HPP_
+#define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_CONTIG_HPP_
+
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace binary::parser {
+
+  /**
+   * @brief interned chromosome name
+   *
+   * Names are interned once per process, so contigs of different files with the same name are
+   * equal. Contigs are compared by id for equality and by name for ordering.
+   */
+  class Contig {
+  public:
+    struct Entry {
+      std::string name;
+      std::int32_t id;
+    };
+
+    constexpr Contig() = default;
+
+    /**
+     * @brief intern a chromosome name, empty name is the default contig
+     */
+    explicit Contig(std::string_view name);
+
+    [[nodiscard]] auto name() const noexcept -> std::string_view {
+      return entry_ == nullptr ? std::string_view{} : std::string_view{entry_->name};
+    }
+
+    /**
+     * @return process wide id of the name, -1 for the default contig
+     */
+    [[nodiscard]] auto id() const noexcept -> std::int32_t {
+      return entry_ == nullptr ? -1 : entry_->id;
+    }
+
+    [[nodiscard]] auto empty() const noexcept -> bool { return entry_ == nullptr; }
+
+    /**
+     * @return number of interned names in the process
+     */
+    static auto interned_size() -> std::size_t;
+
+    friend auto operator==(Contig const& lhs, Contig const& rhs) noexcept -> bool {
+      return lhs.entry_ == rhs.entry_;
+    }
+
+    friend auto operator<=>(Contig const& lhs, Contig const& rhs) noexcept
+        -> std::strong_ordering {
+      if (lhs.entry_ == rhs.entry_) return std::strong_ordering::equal;
+      return lhs.name() <=> rhs.name();
+    }
+
+    friend auto operator==(Contig const& lhs, std::string_view rhs) noexcept -> bool {
+      return lhs.name() == rhs;
+    }
+
+    friend auto operator<=>(Contig const& lhs, std::string_view rhs) noexcept
+        -> std::strong_ordering {
+      return lhs.name() <=> rhs;
+    }
+
+    friend auto operator<<(std::ostream& os, Contig const& contig) -> std::ostream& {
+      return os << contig.name();
+    }
+
+  private:
+    Entry const* entry_{nullptr};
+  };
+
+}  // namespace binary::parser
+
+template <> struct std::hash<binary::parser::Contig> {
+  auto operator()(binary::parser::Contig const& contig) const noexcept -> std::size_t {
+    return std::hash<std::int32_t>{}(contig.id());
+  }
+};
+
+#endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_CONTIG_HPP_
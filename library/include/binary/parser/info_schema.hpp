@@ -0,0 +1,214 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_INFO_SCHEMA_HPP_
+#define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_INFO_SCHEMA_HPP_
+
+#include <algorithm>
+#include <array>
+#include <binary/concepts.hpp>
+#include <binary/exception.hpp>
+#include <binary/parser/vcf.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace binary::parser::vcf {
+
+  /**
+   * @brief string literal usable as a template argument, e.g. InfoKey<"SVTYPE", char>
+   */
+  template <std::size_t N> struct FixedString {
+    std::array<char, N> chars{};  // NUL terminated
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    constexpr FixedString(char const (&str)[N]) { std::copy_n(str, N, chars.begin()); }
+
+    [[nodiscard]] constexpr auto view() const -> std::string_view { return {chars.data(), N - 1}; }
+  };
+
+  /**
+   * @brief FNV-1a hash of an info key
+   */
+  constexpr auto hash_info_key(std::string_view key) noexcept -> std::uint64_t {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (auto c : key) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  namespace details {
+    /**
+     * @brief smallest table in which hashes of keys do not collide
+     */
+    template <std::size_t N>
+    consteval auto perfect_hash_size(std::array<std::string_view, N> const& keys)
+        -> std::size_t {
+      constexpr std::size_t max_size = N * N * 8;
+      for (std::size_t n = N; n <= max_size; ++n) {
+        auto used = std::array<bool, max_size>{};
+        auto collide = false;
+        for (auto key : keys) {
+          auto slot = hash_info_key(key) % n;
+          collide = collide || used[slot];
+          used[slot] = true;
+        }
+        if (!collide) return n;
+      }
+      throw "No perfect hash for the keys";
+    }
+
+    /**
+     * @return index of key + 1 in the slot of its hash, 0 for empty slots
+     */
+    template <std::size_t Size, std::size_t N>
+    consteval auto perfect_hash_slots(std::array<std::string_view, N> const& keys)
+        -> std::array<std::uint8_t, Size> {
+      auto slots = std::array<std::uint8_t, Size>{};
+      for (std::size_t i = 0; i < N; ++i) {
+        slots[hash_info_key(keys[i]) % Size] = static_cast<std::uint8_t>(i + 1);
+      }
+      return slots;
+    }
+  }  // namespace details
+
+  /**
+   * @brief key of an InfoSchema and the type it is decoded to
+   *
+   * Strings are decoded to std::string_view, flags to bool and numbers to their first value.
+   */
+  template <FixedString Name, typename T>
+    requires binary::concepts::IsAnyOf<T, bool, int, float, char, pos_t, int64_t>
+  struct InfoKey {
+    using type = T;
+    using value_type = std::conditional_t<std::same_as<T, char>, std::string_view, T>;
+    static constexpr std::string_view key = Name.view();
+  };
+
+  /**
+   * @brief info keys fixed at compile time, decoded without runtime key strings
+   *
+   * Values are stored in place and string values are views: into the record for htslib
+   * readers, which are valid until the reader moves on, and into the line for text readers.
+   * Text INFO columns are decoded in one pass and every entry is dispatched by a perfect hash
+   * of the keys built at compile time.
+   * @code
+   * auto schema = InfoSchema<InfoKey<"SVTYPE", char>, InfoKey<"END", pos_t>>{};
+   * schema.decode(line.info);
+   * auto svtype = schema.get<"SVTYPE">();
+   * @endcode
+   */
+  template <typename... Keys> class InfoSchema {
+  public:
+    static constexpr std::size_t size = sizeof...(Keys);
+    static constexpr std::array<std::string_view, size> keys{Keys::key...};
+
+    static_assert(size > 0 && size <= 64, "InfoSchema supports 1 to 64 keys");
+    static_assert(
+        [] {
+          for (std::size_t i = 0; i < size; ++i) {
+            for (std::size_t j = i + 1; j < size; ++j) {
+              if (keys[i] == keys[j]) return false;
+            }
+          }
+          return true;
+        }(),
+        "Keys of InfoSchema must be unique");
+
+    template <FixedString Name> static consteval auto index_of() -> std::size_t {
+      auto iter = std::ranges::find(keys, Name.view());
+      if (iter == keys.end()) throw "Key is not in InfoSchema";
+      return static_cast<std::size_t>(iter - keys.begin());
+    }
+
+    /**
+     * @return value of key, false for a missing flag
+     * @throws VcfReaderError if key of other types is missing in the last decoded record
+     */
+    template <FixedString Name> [[nodiscard]] auto get() const {
+      constexpr auto index = index_of<Name>();
+      if constexpr (std::same_as<typename key_type<index>::type, bool>) {
+        return has<Name>();
+      } else {
+        if (!has<Name>()) throw VcfReaderError("Failed to get info " + std::string(Name.view()));
+        return std::get<index>(values_);
+      }
+    }
+
+    template <FixedString Name> [[nodiscard]] auto has() const noexcept -> bool {
+      return (present_ >> index_of<Name>()) & 1U;
+    }
+
+    /**
+     * @brief decode keys from the current record of a htslib reader
+     */
+    void decode(details::DataImpl& data) {
+      auto const& ids = key_ids_.resolve(data, keys);
+      present_ = 0;
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (decode_record<I>(data, ids[I]), ...);
+      }(std::make_index_sequence<size>{});
+    }
+
+    /**
+     * @brief decode keys from the INFO column of a text line, see VcfTextLine
+     */
+    void decode(std::string_view info) {
+      present_ = 0;
+      while (!info.empty()) {
+        auto entry_end = info.find(';');
+        auto entry = info.substr(0, entry_end);
+        info.remove_prefix(entry_end == std::string_view::npos ? info.size() : entry_end + 1);
+
+        auto value_begin = entry.find('=');
+        auto key = entry.substr(0, value_begin);
+        auto slot = SLOTS[hash_info_key(key) % SLOTS.size()];
+        if (slot == 0 || keys[slot - 1] != key) continue;
+
+        auto value = value_begin == std::string_view::npos ? std::string_view{}
+                                                           : entry.substr(value_begin + 1);
+        assign(slot - 1, value);
+      }
+    }
+
+  private:
+    template <std::size_t I> using key_type = std::tuple_element_t<I, std::tuple<Keys...>>;
+
+    static constexpr auto SLOTS
+        = details::perfect_hash_slots<details::perfect_hash_size(keys)>(keys);
+
+    template <std::size_t I> void decode_record(details::DataImpl& data, int key_id) {
+      using T = typename key_type<I>::type;
+      if (!data.template info<bool>(key_id, keys[I])) return;
+
+      present_ |= std::uint64_t{1} << I;
+      std::get<I>(values_) = data.template info<T>(key_id, keys[I]);
+    }
+
+    void assign(std::size_t index, std::string_view value) {
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        static_cast<void>(((I == index ? (assign_text<I>(value), true) : false) || ...));
+      }(std::make_index_sequence<size>{});
+    }
+
+    template <std::size_t I> void assign_text(std::string_view value) {
+      using T = typename key_type<I>::type;
+      std::get<I>(values_) = details::parse_text_info_value<T>(value, keys[I]);
+      present_ |= std::uint64_t{1} << I;
+    }
+
+    std::tuple<typename Keys::value_type...> values_{};
+    std::uint64_t present_{0};
+    details::InfoKeyIds<size> key_ids_{};
+  };
+
+}  // namespace binary::parser::vcf
+
+#endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_INFO_SCHEMA_HPP_
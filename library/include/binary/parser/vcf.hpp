@@ -4,31 +4,44 @@
 
 #ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_HPP_
 #define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_HPP_
+#include <htslib/bgzf.h>
 #include <htslib/tbx.h>
+#include <htslib/thread_pool.h>
 #include <htslib/vcf.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <array>
+#include <atomic>
 #include <binary/algorithm/interval_tree.hpp>
 #include <binary/concepts.hpp>
 #include <binary/exception.hpp>
+#include <binary/parser/contig.hpp>
+#include <binary/parser/vcf_text.hpp>
 #include <binary/utils.hpp>
+#include <charconv>
+#include <cstdlib>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <span>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
-// TODO: Implement thread safe version
 namespace binary::parser::vcf {
   using pos_t = std::uint32_t;
   using chrom_t [[maybe_unused]] = std::string;
+  using binary::parser::Contig;
 
   namespace details {
 
@@ -43,6 +56,10 @@ namespace binary::parser::vcf {
         hts_itr_destroy(record);
       } else if constexpr (std::same_as<T, tbx_t>) {
         tbx_destroy(record);
+      } else if constexpr (std::same_as<T, hts_idx_t>) {
+        hts_idx_destroy(record);
+      } else if constexpr (std::same_as<T, hts_tpool>) {
+        hts_tpool_destroy(record);
       } else if constexpr (std::same_as<T, kstring_t>) {
         free(record->s);
         delete record;
@@ -58,6 +75,17 @@ namespace binary::parser::vcf {
       return hts_unique_ptr<T>{ptr, &hts_deleter<T>};
     }
 
+    /**
+     * @brief share ptr with hts_deleter, empty if ptr is nullptr
+     *
+     * shared_ptr::reset(ptr, deleter) keeps the deleter even for nullptr, and destroy functions
+     * of htslib like tbx_destroy do not accept nullptr.
+     */
+    template <typename T> auto make_hts_shared_ptr(T* ptr) -> std::shared_ptr<T> {
+      if (ptr == nullptr) return nullptr;
+      return {ptr, &hts_deleter<T>};
+    }
+
     // #define BCF_HT_FLAG 0  header type
     // #define BCF_HT_INT  1
     // #define BCF_HT_REAL 2
@@ -72,14 +100,16 @@ namespace binary::parser::vcf {
     constexpr int BINARY_BCF_HT_LONG = (BINARY_BCF_HT_INT | 0x100);
 
     template <typename Datatype>
-      requires binary::concepts::IsAnyOf<Datatype, int, float, char, pos_t, int64_t>
+      requires binary::concepts::IsAnyOf<Datatype, bool, int, float, char, pos_t, int64_t>
     struct InfoGetter {
       Datatype* data{nullptr};
       int32_t count{};
       int data_id{BINARY_BCF_HT_DEFAULT};
 
       constexpr InfoGetter() {
-        if constexpr (std::same_as<Datatype, pos_t>) {
+        if constexpr (std::same_as<Datatype, bool>) {
+          data_id = BINARY_BCF_HT_FLAG;
+        } else if constexpr (std::same_as<Datatype, pos_t>) {
           data_id = BINARY_BCF_HT_INT;
         } else if constexpr (std::same_as<Datatype, float>) {
           data_id = BINARY_BCF_HT_REAL;
@@ -100,7 +130,10 @@ namespace binary::parser::vcf {
       constexpr ~InfoGetter() { free(data); }
 
       constexpr auto result() {
-        if constexpr (std::same_as<Datatype, char>) {
+        if constexpr (std::same_as<Datatype, bool>) {
+          // flags carry no value, count is set to the return value of htslib
+          return count > 0;
+        } else if constexpr (std::same_as<Datatype, char>) {
           return std::string(data, count - 1);
         } else {
           return *data;
@@ -124,29 +157,522 @@ namespace binary::parser::vcf {
                                         &info_field.count, info_field.data_id);
           ret < 0) {
         throw VcfReaderError("Failed to get info " + std::string(key));
+      } else if constexpr (std::same_as<DataType, bool>) {
+        info_field.count = ret;
       }
 
       return info_field.result();
     }
 
+    /**
+     * @brief convert a value found in the INFO column of a text vcf line
+     * @param value value of key, std::nullopt if key is missing
+     * @return std::string_view into value for char, the first value for numbers
+     */
+    template <typename DataType>
+      requires binary::concepts::IsAnyOf<DataType, bool, int, float, char, pos_t, int64_t>
+    auto parse_text_info_value(std::optional<std::string_view> value, std::string_view key) {
+      if constexpr (std::same_as<DataType, bool>) {
+        return value.has_value();
+      } else {
+        if (!value || value->empty()) {
+          throw VcfReaderError("Failed to get info " + std::string(key));
+        }
+
+        if constexpr (std::same_as<DataType, char>) {
+          return *value;
+        } else {
+          auto first = value->substr(0, value->find(','));
+          auto const* first_end = first.data() + first.size();
+          auto result = DataType{};
+          if constexpr (std::same_as<DataType, float>) {
+            // from_chars of float is missing in older libstdc++
+            auto text = std::string(first);
+            char* end = nullptr;
+            result = std::strtof(text.c_str(), &end);
+            if (end != text.c_str() + text.size()) {
+              throw VcfReaderError("Info " + std::string(key) + " is not a number");
+            }
+          } else if (auto [ptr, ec] = std::from_chars(first.data(), first_end, result);
+                     ec != std::errc{} || ptr != first_end) {
+            throw VcfReaderError("Info " + std::string(key) + " is not a number");
+          }
+          return result;
+        }
+      }
+    }
+
+    /**
+     * @brief decode info field from the INFO column of a text vcf line, see VcfTextReader
+     *
+     * Only key is scanned, the first value is used for numbers like get_info_field.
+     */
+    template <typename DataType>
+      requires binary::concepts::IsAnyOf<DataType, bool, int, float, char, pos_t, int64_t>
+    auto get_text_info_field(std::string_view info, std::string_view key) {
+      auto value = parse_text_info_value<DataType>(VcfTextReader::find_info(info, key), key);
+      if constexpr (std::same_as<DataType, char>) {
+        return std::string(value);
+      } else {
+        return value;
+      }
+    }
+
+    /**
+     * @brief length of the reference of a text vcf line, END overrides REF as in htslib
+     */
+    inline auto get_text_rlen(VcfTextLine const& line) -> pos_t {
+      if (auto value = VcfTextReader::find_info(line.info, "END"); value) {
+        auto end = parse_text_info_value<pos_t>(value, "END");
+        if (end > line.pos) return end - line.pos;
+      }
+      return static_cast<pos_t>(line.ref.size());
+    }
+
+    /**
+     * @brief buffer reused by htslib for info values of one type
+     */
+    template <typename T> struct InfoBuffer {
+      T* data{nullptr};
+      int32_t capacity{};  // number of T, may be larger than the last value
+
+      constexpr InfoBuffer() = default;
+      InfoBuffer(InfoBuffer const&) = delete;
+      auto operator=(InfoBuffer const&) -> InfoBuffer& = delete;
+      InfoBuffer(InfoBuffer&& other) noexcept
+          : data{std::exchange(other.data, nullptr)}, capacity{std::exchange(other.capacity, 0)} {}
+      auto operator=(InfoBuffer&& other) noexcept -> InfoBuffer& {
+        std::swap(data, other.data);
+        std::swap(capacity, other.capacity);
+        return *this;
+      }
+      ~InfoBuffer() { free(data); }
+    };
+
+    /**
+     * @brief decode info fields of the current record without allocation in steady state
+     *
+     * Buffers grow to the largest value seen and are kept across records. String views
+     * are valid until the next string is decoded by the same decoder.
+     */
+    class InfoDecoder {
+    public:
+      template <typename DataType>
+        requires binary::concepts::IsAnyOf<DataType, bool, int, float, char, pos_t, int64_t>
+      auto get(std::string_view key, const bcf_hdr_t* hdr, bcf1_t* record) {
+        if constexpr (std::same_as<DataType, bool>) {
+          return fetch(key, hdr, record, flag_buffer_, BINARY_BCF_HT_FLAG) > 0;
+        } else if constexpr (std::same_as<DataType, char>) {
+          auto len = static_cast<std::size_t>(
+              fetch(key, hdr, record, str_buffer_, BINARY_BCF_HT_STR));
+          // bcf strings may be padded with NUL
+          auto value = std::string_view{str_buffer_.data, len};
+          return value.substr(0, value.find('\0'));
+        } else if constexpr (std::same_as<DataType, float>) {
+          fetch(key, hdr, record, real_buffer_, BINARY_BCF_HT_REAL);
+          return *real_buffer_.data;
+        } else if constexpr (std::same_as<DataType, int64_t>) {
+          fetch(key, hdr, record, long_buffer_, BINARY_BCF_HT_LONG);
+          return *long_buffer_.data;
+        } else {
+          fetch(key, hdr, record, int_buffer_, BINARY_BCF_HT_INT);
+          return static_cast<DataType>(*int_buffer_.data);
+        }
+      }
+
+      /**
+       * @brief decode info field by its header id, see InfoKeyIds
+       *
+       * Values are read from the unpacked record directly, string views are valid until the
+       * next record is read.
+       */
+      template <typename DataType>
+        requires binary::concepts::IsAnyOf<DataType, bool, int, float, char, pos_t, int64_t>
+      auto get(int key_id, std::string_view key, bcf1_t* record) const {
+        auto const* info = key_id < 0 ? nullptr : bcf_get_info_id(record, key_id);
+        bool found = info != nullptr && info->vptr != nullptr;
+
+        if constexpr (std::same_as<DataType, bool>) {
+          return found;
+        } else {
+          if (!found || info->len < 1) throw VcfReaderError("Failed to get info " + std::string(key));
+
+          if constexpr (std::same_as<DataType, char>) {
+            if (info->type != BCF_BT_CHAR) {
+              throw VcfReaderError("Info " + std::string(key) + " is not a string");
+            }
+            auto value = std::string_view{reinterpret_cast<const char*>(info->vptr),
+                                          static_cast<std::size_t>(info->len)};
+            return value.substr(0, value.find('\0'));
+          } else {
+            return first_value<DataType>(*info, key);
+          }
+        }
+      }
+
+    private:
+      template <typename DataType>
+      static auto first_value(bcf_info_t const& info, std::string_view key) -> DataType {
+        switch (info.type) {
+          case BCF_BT_INT8:
+            return static_cast<DataType>(*reinterpret_cast<const int8_t*>(info.vptr));
+          case BCF_BT_INT16:
+            return static_cast<DataType>(*reinterpret_cast<const int16_t*>(info.vptr));
+          case BCF_BT_INT32:
+            return static_cast<DataType>(*reinterpret_cast<const int32_t*>(info.vptr));
+          case BCF_BT_FLOAT:
+            return static_cast<DataType>(*reinterpret_cast<const float*>(info.vptr));
+          default:
+            throw VcfReaderError("Info " + std::string(key) + " is not a number");
+        }
+      }
+
+      template <typename T> static auto fetch(std::string_view key, const bcf_hdr_t* hdr,
+                                              bcf1_t* record, InfoBuffer<T>& buffer, int type)
+          -> int {
+        int ret = bcf_get_info_values(hdr, record, key.data(),
+                                      reinterpret_cast<void**>(&buffer.data), &buffer.capacity,
+                                      type);
+        // flag returns 0 if absent, other types need at least one value
+        if (ret < 0 || (ret == 0 && type != BINARY_BCF_HT_FLAG)) {
+          throw VcfReaderError("Failed to get info " + std::string(key));
+        }
+        return ret;
+      }
+
+      InfoBuffer<char> flag_buffer_{};  // never written by htslib
+      InfoBuffer<char> str_buffer_{};
+      InfoBuffer<int32_t> int_buffer_{};
+      InfoBuffer<float> real_buffer_{};
+      InfoBuffer<int64_t> long_buffer_{};
+    };
+
+    /**
+     * @brief get the htslib thread pool shared by all readers in the process
+     * @param num_threads number of threads, only used when the pool is created
+     * @return nullptr if num_threads < 1
+     */
+    inline auto shared_thread_pool(int num_threads) -> std::shared_ptr<hts_tpool> {
+      static std::mutex mutex{};
+      static std::shared_ptr<hts_tpool> pool{nullptr};
+
+      if (num_threads < 1) return nullptr;
+
+      std::lock_guard lock{mutex};
+      if (pool == nullptr) {
+        // hts_tpool_destroy does not accept the nullptr of a failed init
+        pool = make_hts_shared_ptr(hts_tpool_init(num_threads));
+        if (pool == nullptr) {
+          throw VcfReaderError("Failed to create thread pool with "
+                               + std::to_string(num_threads) + " threads");
+        }
+      } else if (hts_tpool_size(pool.get()) != num_threads) {
+        spdlog::debug("thread pool already has {} threads, ignore {}", hts_tpool_size(pool.get()),
+                      num_threads);
+      }
+      return pool;
+    }
+
+    /**
+     * @brief find bgzf blocks which split the compressed file into about n_parts parts
+     * @param begin compressed offset of the block to start from
+     * @return compressed offsets of the first block of every part except the first one
+     */
+    inline auto bgzf_split_offsets(std::string const& file_path, int64_t begin,
+                                   std::size_t n_parts) -> std::vector<int64_t> {
+      auto offsets = std::vector<int64_t>{};
+      auto file_size = static_cast<int64_t>(std::filesystem::file_size(file_path));
+      if (n_parts < 2 || begin >= file_size) return offsets;
+
+      auto step = (file_size - begin) / static_cast<int64_t>(n_parts);
+      auto next_split = begin + step;
+      auto input = std::ifstream(file_path, std::ios::binary);
+      auto header = std::array<unsigned char, 18>{};
+
+      // walk block headers only, BSIZE is the total block size minus 1
+      for (auto offset = begin; offset < file_size && offsets.size() + 1 < n_parts;) {
+        input.seekg(offset);
+        if (!input.read(reinterpret_cast<char*>(header.data()), header.size())) break;
+        if (header[0] != 0x1f || header[1] != 0x8b || header[12] != 'B' || header[13] != 'C') {
+          throw VcfReaderError("Invalid bgzf block at " + std::to_string(offset) + " of "
+                               + file_path);
+        }
+        if (offset >= next_split) {
+          offsets.push_back(offset);
+          next_split = offset + step;
+        }
+        offset += (header[16] | (header[17] << 8)) + 1;
+      }
+      return offsets;
+    }
+
+    inline auto next_reader_serial() -> std::uint64_t {
+      static std::atomic<std::uint64_t> serial{0};
+      return ++serial;
+    }
+
     struct DataImpl {
       constexpr DataImpl() = default;
-      explicit DataImpl(std::string_view file)
-          : fp{hts_open(file.data(), "r"), &hts_deleter<htsFile>},
-            header{bcf_hdr_read(fp.get()), &hts_deleter<bcf_hdr_t>},
-            record{bcf_init1(), &hts_deleter<bcf1_t>} {}
+
+      /**
+       * @brief open a reader of file
+       * @param shared_header parsed header of the same file, reused instead of parsing it again,
+       * text vcf readers copy it since htslib writes to the header while parsing text records
+       * @param header_end virtual offset of the first record in a bgzipped file, -1 if unknown
+       */
+      explicit DataImpl(std::string_view file, int num_threads = 0,
+                        std::shared_ptr<bcf_hdr_t> shared_header = nullptr,
+                        int64_t header_end = -1)
+          : fp{hts_open(file.data(), "r"), &hts_deleter<htsFile>} {
+        if (!fp) throw VcfReaderError("Failed to open " + std::string(file));
+
+        // attach decompression threads before reading anything
+        if (thread_pool = shared_thread_pool(num_threads); thread_pool) {
+          auto pool = htsThreadPool{thread_pool.get(), 0};
+          if (hts_set_thread_pool(fp.get(), &pool) < 0) {
+            throw VcfReaderError("Failed to set thread pool for " + std::string(file));
+          }
+        }
+
+        if (shared_header && header_end >= 0 && is_bgzf()
+            && bgzf_seek(hts_get_bgzfp(fp.get()), header_end, SEEK_SET) == 0) {
+          if (is_bcf()) {
+            header = std::move(shared_header);
+          } else {
+            header = make_hts_shared_ptr(bcf_hdr_dup(shared_header.get()));
+          }
+        } else {
+          header = make_hts_shared_ptr(bcf_hdr_read(fp.get()));
+        }
+        if (!header) throw VcfReaderError("Failed to read header of " + std::string(file));
+        record.reset(bcf_init1());
+      }
 
       DataImpl(DataImpl const&) = delete;
       auto operator=(DataImpl const&) -> DataImpl& = delete;
       DataImpl(DataImpl&&) noexcept = default;
       auto operator=(DataImpl&&) noexcept -> DataImpl& = default;
 
+      // declared before fp so that the pool outlives the file using it
+      std::shared_ptr<hts_tpool> thread_pool{nullptr};
       hts_unique_ptr<htsFile> fp = make_hts_unique_ptr<htsFile>(nullptr);
-      hts_unique_ptr<bcf_hdr_t> header = make_hts_unique_ptr<bcf_hdr_t>(nullptr);
+      std::shared_ptr<bcf_hdr_t> header{nullptr};  // shared by cursors of bcf files only
       hts_unique_ptr<bcf1_t> record = make_hts_unique_ptr<bcf1_t>(nullptr);
       hts_unique_ptr<hts_itr_t> itr_ptr = make_hts_unique_ptr<hts_itr_t>(nullptr);
-      hts_unique_ptr<tbx_t> idx_ptr = make_hts_unique_ptr<tbx_t>(nullptr);
+      // indexes are read only and shared by readers of the same file
+      std::shared_ptr<tbx_t> idx_ptr{nullptr};
+      std::shared_ptr<hts_idx_t> bcf_idx_ptr{nullptr};
       hts_unique_ptr<kstring_t> ks_ptr = make_hts_unique_ptr<kstring_t>(new kstring_t{});
+      InfoDecoder info_decoder{};
+      std::uint64_t serial{next_reader_serial()};  // identify the opened file for cached key ids
+      std::uint64_t read_count{0};                  // identify the current record for lazy info
+      bool lazy_info{false};                        // decode info only when it is accessed
+      int64_t chunk_end{-1};  // read lines starting up to this virtual offset, -1 if not a chunk
+      std::vector<Contig> contigs{};                // interned contigs indexed by rid
+      // tokenizes lines of plain vcf files instead of htslib, see VcfRanges::begin
+      std::optional<VcfTextReader> text{};
+      Contig text_contig{};  // contig of the last text line
+
+      /**
+       * @brief interned contig of rid, the name is looked up only once for each reader
+       */
+      auto contig(int rid) -> Contig {
+        if (rid < 0) return Contig{};
+        auto index = static_cast<std::size_t>(rid);
+        if (index >= contigs.size()) contigs.resize(index + 1);
+        if (contigs[index].empty()) contigs[index] = Contig{bcf_hdr_id2name(header.get(), rid)};
+        return contigs[index];
+      }
+
+      /**
+       * @brief interned contig of a text line, lines of a chromosome are adjacent
+       */
+      auto contig(std::string_view name) -> Contig {
+        if (text_contig != name) text_contig = Contig{name};
+        return text_contig;
+      }
+
+      /**
+       * @brief decode info field of the current record with buffers of this reader
+       * @return std::string_view for char, which is valid until next string is decoded
+       */
+      template <typename DataType> auto info(std::string_view key) {
+        return info_decoder.get<DataType>(key, header.get(), record.get());
+      }
+
+      /**
+       * @brief decode info field of the current record by header id of the key
+       * @return std::string_view for char, which is valid until next record is read
+       */
+      template <typename DataType> auto info(int key_id, std::string_view key) {
+        return info_decoder.get<DataType>(key_id, key, record.get());
+      }
+
+      [[nodiscard]] auto is_bcf() const -> bool {
+        return hts_get_format(fp.get())->format == htsExactFormat::bcf;
+      }
+
+      [[nodiscard]] auto is_bgzf() const -> bool {
+        return hts_get_format(fp.get())->compression == htsCompression::bgzf;
+      }
+
+      [[nodiscard]] auto is_plain_text() const -> bool {
+        auto const* format = hts_get_format(fp.get());
+        return format->format == htsExactFormat::vcf
+               && format->compression == htsCompression::no_compression;
+      }
+
+      /**
+       * @brief reset the query iterator to the region of tid, positions are 0-based
+       * @return false if the iterator cannot be created
+       */
+      auto query(int tid, hts_pos_t start, hts_pos_t end) -> bool {
+        if (is_bcf()) {
+          itr_ptr.reset(bcf_itr_queryi(bcf_idx_ptr.get(), tid, start, end));
+        } else {
+          itr_ptr.reset(tbx_itr_queryi(idx_ptr.get(), tid, start, end));
+        }
+        return itr_ptr != nullptr;
+      }
+
+      /**
+       * @brief restrict a bgzipped vcf reader to lines starting in (begin, end]
+       *
+       * The line containing begin belongs to the previous chunk and is skipped unless it is
+       * the first chunk, chunks split at any virtual offsets cover every line exactly once.
+       */
+      void seek_chunk(int64_t begin, int64_t end, bool is_first) {
+        auto* bgzf = hts_get_bgzfp(fp.get());
+        if (bgzf_seek(bgzf, begin, SEEK_SET) < 0) {
+          throw VcfReaderError("Failed to seek to " + std::to_string(begin));
+        }
+        if (!is_first && bgzf_getline(bgzf, '\n', ks_ptr.get()) < -1) {
+          throw VcfReaderError("Failed to read line at " + std::to_string(begin));
+        }
+        chunk_end = end;
+      }
+
+      /**
+       * @brief read next record into record, through the query iterator if there is one
+       * @return >= 0 on success, -1 on end of file and < -1 on error
+       */
+      auto read() -> int {
+        ++read_count;
+        if (chunk_end >= 0) return read_chunk_line();
+        if (itr_ptr == nullptr) {
+          return bcf_read(fp.get(), header.get(), record.get());
+        }
+
+        // binary records need no text parsing
+        if (is_bcf()) return bcf_itr_next(fp.get(), itr_ptr.get(), record.get());
+
+        if (int ret = tbx_itr_next(fp.get(), idx_ptr.get(), itr_ptr.get(), ks_ptr.get()); ret < 0) {
+          return ret;
+        }
+        return vcf_parse1(ks_ptr.get(), header.get(), record.get()) < 0 ? -2 : 0;
+      }
+
+    private:
+      auto read_chunk_line() -> int {
+        auto* bgzf = hts_get_bgzfp(fp.get());
+        do {
+          if (bgzf_tell(bgzf) > chunk_end) return -1;
+          if (int ret = bgzf_getline(bgzf, '\n', ks_ptr.get()); ret < 0) return ret;
+        } while (ks_ptr->l == 0);
+        return vcf_parse1(ks_ptr.get(), header.get(), record.get()) < 0 ? -2 : 0;
+      }
+    };
+
+    /**
+     * @brief parsed header and index of one file, shared read-only by cursors of all threads
+     *
+     * Every cursor owns its htsFile and bcf1_t. Cursors of bgzipped files seek past the header
+     * instead of parsing it again. Cursors of bcf files share the parsed header, cursors of
+     * text vcf files get their own copy because htslib uses the header as scratch space and
+     * adds undefined contigs and info keys to it while parsing.
+     */
+    class VcfHandle {
+    public:
+      explicit VcfHandle(std::string file_path) : file_path_{std::move(file_path)} {
+        auto data = DataImpl(file_path_);
+        header_ = data.header;
+        is_bcf_ = data.is_bcf();
+        if (data.is_bgzf()) header_end_ = bgzf_tell(hts_get_bgzfp(data.fp.get()));
+      }
+
+      /**
+       * @brief open a new cursor, safe to call from any thread
+       */
+      [[nodiscard]] auto open(int num_threads = 0) const -> std::shared_ptr<DataImpl> {
+        return std::make_shared<DataImpl>(file_path_, num_threads, header_, header_end_);
+      }
+
+      [[nodiscard]] auto header() const -> bcf_hdr_t const* { return header_.get(); }
+      [[nodiscard]] auto file_path() const -> std::string const& { return file_path_; }
+      [[nodiscard]] auto is_bcf() const -> bool { return is_bcf_; }
+      // virtual offset of the first record, -1 if the file is not bgzipped
+      [[nodiscard]] auto header_end() const -> int64_t { return header_end_; }
+
+      /**
+       * @brief tabix index of bgzipped vcf, loaded once
+       */
+      [[nodiscard]] auto tbx_index() const -> std::shared_ptr<tbx_t> {
+        std::call_once(tbx_once_, [this] {
+          tbx_index_ = make_hts_shared_ptr(tbx_index_load(file_path_.c_str()));
+        });
+        if (!tbx_index_) throw VcfReaderError("Failed to load index for " + file_path_);
+        return tbx_index_;
+      }
+
+      /**
+       * @brief csi index of bcf, loaded once
+       */
+      [[nodiscard]] auto bcf_index() const -> std::shared_ptr<hts_idx_t> {
+        std::call_once(bcf_once_, [this] {
+          bcf_index_ = make_hts_shared_ptr(bcf_index_load(file_path_.c_str()));
+        });
+        if (!bcf_index_) throw VcfReaderError("Failed to load index for " + file_path_);
+        return bcf_index_;
+      }
+
+    private:
+      std::string file_path_{};
+      std::shared_ptr<bcf_hdr_t> header_{nullptr};
+      int64_t header_end_{-1};
+      bool is_bcf_{false};
+
+      mutable std::once_flag tbx_once_{};
+      mutable std::shared_ptr<tbx_t> tbx_index_{nullptr};
+      mutable std::once_flag bcf_once_{};
+      mutable std::shared_ptr<hts_idx_t> bcf_index_{nullptr};
+    };
+
+    /**
+     * @brief header ids of info keys, resolved once for every opened file
+     *
+     * htslib adds info keys missing from the header of a text vcf while parsing, so missing
+     * keys are resolved again whenever the header has grown.
+     */
+    template <std::size_t N> struct InfoKeyIds {
+      std::array<int, N> ids{};
+      std::uint64_t serial{0};  // serial of the reader which ids are resolved for
+      int n_header_ids{-1};     // size of the header dictionary if a key is missing, else -1
+
+      template <typename Keys> auto resolve(DataImpl const& data, Keys const& keys)
+          -> std::array<int, N> const& {
+        auto const* header = data.header.get();
+        if (serial != data.serial
+            || (n_header_ids >= 0 && n_header_ids != header->n[BCF_DT_ID])) {
+          n_header_ids = -1;
+          for (std::size_t i = 0; i < N; ++i) {
+            auto id = bcf_hdr_id2int(header, BCF_DT_ID, std::data(keys[i]));
+            ids[i] = bcf_hdr_idinfo_exists(header, BCF_HL_INFO, id) ? id : -1;
+            if (ids[i] < 0) n_header_ids = header->n[BCF_DT_ID];
+          }
+          serial = data.serial;
+        }
+        return ids;
+      }
     };
 
     struct [[maybe_unused]] BaseInfoField {
@@ -169,9 +695,21 @@ namespace binary::parser::vcf {
                                  std::cout << t;
                                };
 
+    /**
+     * @brief info type which also decodes the INFO column of a text vcf line
+     *
+     * Records of plain vcf files with such info are tokenized by VcfTextReader, see VcfRanges.
+     */
+    template <typename T>
+    concept TextInfoFieldConcept = InfoFieldConcept<T> && requires(T t) {
+                                                            t.update(std::string_view{},
+                                                                     std::string_view{});
+                                                          };
+
     template <typename... T> struct InfoFieldFactory : public details::BaseInfoField {
       std::tuple<decltype(InfoGetter<T>::result_type())...> data_tuple{};
       std::array<std::string, sizeof...(T)> keys_array{};
+      InfoKeyIds<sizeof...(T)> key_ids{};
 
       template <typename... U>
         requires(std::convertible_to<U, std::string> && ...)
@@ -187,14 +725,119 @@ namespace binary::parser::vcf {
       template <typename... U> void init_keys(U... keys) {
         static_assert(sizeof...(U) == sizeof...(T), "Number of keys and values do not match");
         keys_array = {keys...};
+        key_ids = {};
       }
 
       void update(std::shared_ptr<details::DataImpl> const& data, std::string_view) override {
-        data_tuple = [&]<std::size_t... I>(std::index_sequence<I...>) {
-          return std::tuple(
-              get_info_field<T>(keys_array[I], data->header.get(), data->record.get())...);
+        auto const& ids = key_ids.resolve(*data, keys_array);
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+          ((std::get<I>(data_tuple) = data->template info<T>(ids[I], keys_array[I])), ...);
         }(std::make_index_sequence<sizeof...(T)>{});
       }
+
+      /**
+       * @brief decode the keys from the INFO column of a text line without htslib
+       *
+       * Records of plain vcf files are decoded by it, see TextInfoFieldConcept.
+       * @param info INFO column, e.g. VcfTextLine::info
+       */
+      void update(std::string_view info, std::string_view = {}) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+          ((std::get<I>(data_tuple) = parse_text_info_value<T>(
+                VcfTextReader::find_info(info, keys_array[I]), keys_array[I])),
+           ...);
+        }(std::make_index_sequence<sizeof...(T)>{});
+      }
+
+      friend auto operator<<(std::ostream& os, InfoFieldFactory const& info) -> std::ostream& {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+          ((os << (I == 0 ? "" : " ") << info.keys_array[I] << ": " << std::get<I>(info.data_tuple)),
+           ...);
+        }(std::make_index_sequence<sizeof...(T)>{});
+        return os;
+      }
+    };
+
+    /**
+     * @brief owner of the info of a record which can be decoded on first access
+     *
+     * Used like std::unique_ptr<InfoType>. A deferred info is decoded from the reader only when
+     * the reader still holds the same record, otherwise VcfReaderError is thrown.
+     */
+    template <typename InfoType> class LazyInfo {
+    public:
+      LazyInfo() : value_{std::make_unique<InfoType>()} {}
+      LazyInfo(LazyInfo const& other)
+          : value_{std::make_unique<InfoType>(*other.value_)},
+            data_{other.data_},
+            source_{other.source_},
+            read_count_{other.read_count_},
+            pending_{other.pending_} {}
+      auto operator=(LazyInfo const& other) -> LazyInfo& {
+        if (this != &other) *this = LazyInfo(other);
+        return *this;
+      }
+      LazyInfo(LazyInfo&&) noexcept = default;
+      auto operator=(LazyInfo&&) noexcept -> LazyInfo& = default;
+      ~LazyInfo() = default;
+
+      /**
+       * @brief decode info of the current record of data now
+       */
+      void update(std::shared_ptr<DataImpl> const& data, std::string_view source) {
+        pending_ = false;
+        data_.reset();
+        value_->update(data, source);
+      }
+
+      /**
+       * @brief decode info from the INFO column of a text vcf line now
+       */
+      void update(std::string_view info_column, std::string_view source)
+        requires TextInfoFieldConcept<InfoType>
+      {
+        pending_ = false;
+        data_.reset();
+        value_->update(info_column, source);
+      }
+
+      /**
+       * @brief remember the current record of data and decode info on first access
+       */
+      void defer(std::shared_ptr<DataImpl> const& data, std::string_view source) {
+        pending_ = true;
+        data_ = data;
+        source_ = source;
+        read_count_ = data->read_count;
+      }
+
+      [[nodiscard]] auto is_pending() const -> bool { return pending_; }
+
+      auto get() const -> InfoType* {
+        materialize();
+        return value_.get();
+      }
+      auto operator->() const -> InfoType* { return get(); }
+      auto operator*() const -> InfoType& { return *get(); }
+
+    private:
+      void materialize() const {
+        if (!pending_) return;
+
+        auto data = data_.lock();
+        if (data == nullptr || data->read_count != read_count_) {
+          throw VcfReaderError("Info is accessed after the reader moved to another record");
+        }
+        value_->update(data, source_);
+        pending_ = false;
+        data_.reset();
+      }
+
+      std::unique_ptr<InfoType> value_{nullptr};
+      mutable std::weak_ptr<DataImpl> data_{};
+      std::string source_{};
+      std::uint64_t read_count_{0};
+      mutable bool pending_{false};
     };
 
   }  // namespace details
@@ -202,12 +845,15 @@ namespace binary::parser::vcf {
   // export template this namespace
   using details::BaseInfoField;
   using details::get_info_field;
+  using details::get_text_info_field;
   using details::InfoFieldConcept;
   using details::InfoFieldFactory;
+  using details::TextInfoFieldConcept;
 
   struct [[maybe_unused]] InfoField : public BaseInfoField {
     std::string svtype{};
     pos_t svend{};
+    details::InfoKeyIds<2> key_ids{};
 
     constexpr InfoField() = default;
     InfoField(InfoField const&) = default;
@@ -217,8 +863,15 @@ namespace binary::parser::vcf {
     ~InfoField() override = default;
 
     void update(std::shared_ptr<details::DataImpl> const& data, std::string_view) override {
-      svtype = details::get_info_field<char>("SVTYPE", data->header.get(), data->record.get());
-      svend = details::get_info_field<pos_t>("SVEND", data->header.get(), data->record.get());
+      constexpr std::array<std::string_view, 2> keys{"SVTYPE", "SVEND"};
+      auto const& ids = key_ids.resolve(*data, keys);
+      svtype = data->info<char>(ids[0], keys[0]);
+      svend = data->info<pos_t>(ids[1], keys[1]);
+    }
+
+    void update(std::string_view info, std::string_view) {
+      svtype = details::get_text_info_field<char>(info, "SVTYPE");
+      svend = details::get_text_info_field<pos_t>(info, "SVEND");
     }
 
     friend auto operator<<(std::ostream& os, InfoField const& info) -> std::ostream& {
@@ -231,6 +884,8 @@ namespace binary::parser::vcf {
   template <InfoFieldConcept InfoType> class BaseVcfRecord {
   public:
     using info_type = InfoType;
+    // records of plain vcf files are read by VcfTextReader, see VcfRanges::begin
+    static constexpr bool is_text_readable = TextInfoFieldConcept<InfoType>;
 
     constexpr BaseVcfRecord() = default;
     explicit BaseVcfRecord(std::shared_ptr<details::DataImpl> const& data)
@@ -256,13 +911,39 @@ namespace binary::parser::vcf {
 
     constexpr void set_eof() { eof_ = true; }
 
+    /**
+     * @brief copy of the record which keeps no reference to the reader, info is decoded
+     */
+    [[nodiscard]] auto materialize() const -> BaseVcfRecord {
+      static_cast<void>(info.get());  // decode deferred info while the reader is still here
+      return BaseVcfRecord{*this};
+    }
+
     template <typename... T> void init_info_keys(T&&... args) {
       info->init_keys(std::forward<T>(args)...);
     }
 
+    /**
+     * @brief decode keys of schema from the current record of the reader, see InfoSchema
+     */
+    template <typename Schema> void decode_info(Schema& schema) const {
+      if (auto data = data_.lock()) {
+        schema.decode(*data);
+      } else {
+        throw VcfReaderError("Using dangling VcfRecord");
+      }
+    }
+
     void next() {
       if (auto data = data_.lock()) {
-        if (int ret = bcf_read(data->fp.get(), data->header.get(), data->record.get()); ret < -1) {
+        if constexpr (is_text_readable) {
+          if (data->text) {
+            next_text(*data);
+            return;
+          }
+        }
+
+        if (int ret = data->read(); ret < -1) {
           throw VcfReaderError("Failed to read line in vcf ");
         } else if (ret == -1) {
           set_eof();
@@ -287,11 +968,11 @@ namespace binary::parser::vcf {
     std::weak_ptr<details::DataImpl> data_{};
     bool eof_{true};  //  default constructor is true
 
-    std::string chrom{};
+    Contig chrom{};
     pos_t pos{};
     pos_t rlen{};
     std::string source_{};
-    std::unique_ptr<InfoType> info{std::make_unique<InfoType>()};
+    details::LazyInfo<InfoType> info{};
 
   protected:
     void clone(BaseVcfRecord const& other) noexcept {
@@ -299,14 +980,33 @@ namespace binary::parser::vcf {
       pos = other.pos;
       rlen = other.rlen;
       source_ = other.source_;
-      info = std::make_unique<InfoType>(*other.info);
+      info = other.info;
+    }
+
+    void next_text(details::DataImpl& data) {
+      auto line = VcfTextLine{};
+      if (!data.text->next(line)) {
+        set_eof();
+        return;
+      }
+
+      ++data.read_count;
+      chrom = data.contig(line.chrom);
+      pos = line.pos;
+      rlen = details::get_text_rlen(line);
+      // scanning a text INFO column is cheap, it is decoded at once even for lazy info
+      info.update(line.info, source_);
     }
 
     void update(std::shared_ptr<details::DataImpl> const& data) {
-      chrom = bcf_seqname_safe(data->header.get(), data->record.get());
+      chrom = data->contig(data->record->rid);
       pos = static_cast<pos_t>(data->record->pos);
       rlen = static_cast<pos_t>(data->record->rlen);
-      info->update(data, source_);
+      if (data->lazy_info) {
+        info.defer(data, source_);
+      } else {
+        info.update(data, source_);
+      }
     }
   };
 
@@ -327,10 +1027,18 @@ namespace binary::parser::vcf {
 
     VcfRanges(std::string file_path, std::string source);
 
-    VcfRanges(VcfRanges const& other) : VcfRanges(other.file_path_) {}
+    // copies are cursors sharing the header and index, use one copy for every thread
+    VcfRanges(VcfRanges const& other) : VcfRanges(other.file_path_, other.source_) {
+      num_threads_ = other.num_threads_;
+      lazy_info_ = other.lazy_info_;
+      handle_ = other.handle_;
+    }
     auto operator=(VcfRanges const& other) -> VcfRanges& {
       file_path_ = other.file_path_;
       source_ = other.source_;
+      num_threads_ = other.num_threads_;
+      lazy_info_ = other.lazy_info_;
+      handle_ = other.handle_;
       pdata_.reset();
       return *this;
     }
@@ -341,8 +1049,9 @@ namespace binary::parser::vcf {
     class iterator {
     public:
       friend class VcfRanges;
-      using iterator_concept = std::forward_iterator_tag;
-      using iterator_category = std::forward_iterator_tag;
+      // single pass, copies share the current record and advance together
+      using iterator_concept = std::input_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
       using value_type = std::remove_cv_t<RecordType>;
       using difference_type = std::ptrdiff_t;
       using pointer = const RecordType*;
@@ -352,18 +1061,13 @@ namespace binary::parser::vcf {
       constexpr iterator() = default;
 
       explicit constexpr iterator(std::shared_ptr<details::DataImpl> const& data)
-          : value_{std::make_unique<value_type>(data)} {}
+          : data_{data}, value_{std::make_shared<value_type>(data)} {}
 
       constexpr iterator(std::shared_ptr<details::DataImpl> const& data, std::string_view source)
-          : value_{std::make_unique<value_type>(data, source)} {}
-
-      constexpr iterator(iterator const& other) { clone(other); };
-
-      constexpr auto operator=(iterator const& other) -> iterator& {
-        clone(other);
-        return *this;
-      };
+          : data_{data}, value_{std::make_shared<value_type>(data, source)} {}
 
+      constexpr iterator(iterator const& other) = default;
+      constexpr auto operator=(iterator const& other) -> iterator& = default;
       constexpr iterator(iterator&&) noexcept = default;
       constexpr auto operator=(iterator&&) noexcept -> iterator& = default;
 
@@ -371,18 +1075,14 @@ namespace binary::parser::vcf {
 
       // public member functions
       auto operator->() const -> pointer { return value_.get(); }
-      auto operator*() const -> value_type { return *value_; }
+      // valid until the iterator is incremented, use materialize() to keep the record
+      auto operator*() const -> reference { return *value_; }
       auto operator++() -> iterator& {
         value_->next();
         return *this;
       }
 
-      // old and new iterator will change at same time
-      auto operator++(int) -> iterator {
-        auto copy = *this;
-        ++(*this);
-        return copy;
-      }
+      void operator++(int) { ++(*this); }
 
       friend auto operator==(iterator const& lhs, iterator const& rhs) -> bool = default;
       friend auto operator==(iterator const& lhs, std::default_sentinel_t) -> bool {
@@ -393,9 +1093,92 @@ namespace binary::parser::vcf {
       }
 
     private:
-      void clone(iterator const& other) { value_ = std::make_unique<value_type>(*(other.value_)); }
+      std::shared_ptr<details::DataImpl> data_{};  // keep the cursor alive while iterating
+      std::shared_ptr<value_type> value_{};
+    };
+
+    /**
+     * @brief Records overlapping one region, read through the index of the file
+     *
+     * Every call of begin() restarts the query from the first hit.
+     */
+    class query_ranges : public std::ranges::view_interface<query_ranges> {
+    public:
+      constexpr query_ranges() = default;
+      query_ranges(std::shared_ptr<details::DataImpl> data, std::string source, int tid,
+                   hts_pos_t start, hts_pos_t end)
+          : data_{std::move(data)},
+            source_{std::move(source)},
+            tid_{tid},
+            start_{start},
+            end_{end} {}
+
+      auto begin() const -> iterator {
+        // contig without any record in the index
+        if (data_ == nullptr || tid_ < 0) return iterator{};
+
+        if (!data_->query(tid_, start_, end_)) {
+          throw VcfReaderError("Query-> Failed to query " + std::to_string(tid_) + ":"
+                               + std::to_string(start_) + "-" + std::to_string(end_));
+        }
+        return iterator{data_, source_};
+      }
 
-      std::unique_ptr<value_type> value_{};
+      [[nodiscard]] constexpr auto end() const -> std::default_sentinel_t {
+        return std::default_sentinel;
+      }
+
+    private:
+      std::shared_ptr<details::DataImpl> data_{nullptr};
+      std::string source_{};
+      int tid_{-1};
+      hts_pos_t start_{};
+      hts_pos_t end_{};
+    };
+
+    /**
+     * @brief Records of one chunk of a file, see chunks()
+     *
+     * Every call of begin() opens a new cursor, so chunks can be read from different threads.
+     */
+    class chunk_ranges : public std::ranges::view_interface<chunk_ranges> {
+    public:
+      constexpr chunk_ranges() = default;
+      chunk_ranges(VcfRanges const& ranges, int64_t begin, int64_t end, bool is_first)
+          : handle_{ranges.handle()},
+            source_{ranges.source_},
+            num_threads_{ranges.num_threads_},
+            lazy_info_{ranges.lazy_info_},
+            begin_{begin},
+            end_{end},
+            is_first_{is_first} {}
+
+      auto begin() const -> iterator {
+        if (handle_ == nullptr) return iterator{};
+
+        auto data = handle_->open(num_threads_);
+        data->lazy_info = lazy_info_;
+        // files which cannot be split are read as a whole
+        if (begin_ >= 0) {
+          data->seek_chunk(begin_, end_, is_first_);
+        } else {
+          read_text_if_plain(*data, handle_->file_path());
+        }
+        return iterator{data, source_};
+      }
+
+      [[nodiscard]] constexpr auto end() const -> std::default_sentinel_t {
+        return std::default_sentinel;
+      }
+
+    private:
+      std::shared_ptr<details::VcfHandle> handle_{nullptr};
+      std::string source_{};
+      int num_threads_{0};
+      bool lazy_info_{false};
+      int64_t begin_{-1};
+      int64_t end_{-1};
+      bool is_first_{true};
     };
 
     /**
@@ -418,17 +1201,22 @@ namespace binary::parser::vcf {
     [[nodiscard]] constexpr auto has_read_index() const -> bool;
 
     /**
-     * Check if  vcf file has index file
+     * Check if  vcf file has index file, either tabix(.tbi) or csi(.csi)
      * @return  true if has index file
      */
     [[nodiscard]] constexpr auto has_index_file() const -> bool;
 
-    constexpr auto iter_query_record() const -> VcfRanges::iterator;
-
-    constexpr auto query(std::string_view chrom, pos_t start, pos_t end) const
-        -> VcfRanges::iterator;
+    /**
+     * Query records overlapping [start, end) of a chromosome, positions are 0-based
+     * @return range of records which can be used in range-for loops and views
+     */
+    auto query(std::string_view chrom, pos_t start, pos_t end) const -> query_ranges;
 
-    constexpr auto query(std::string_view chrom) const -> VcfRanges::iterator;
+    /**
+     * Query all records of a chromosome
+     * @return range of records which can be used in range-for loops and views
+     */
+    auto query(std::string_view chrom) const -> query_ranges;
 
     constexpr auto begin() const -> iterator;
     [[nodiscard]] constexpr auto end() const -> std::default_sentinel_t;
@@ -442,13 +1230,56 @@ namespace binary::parser::vcf {
     [[maybe_unused]] const std::string& get_source() const;
     [[maybe_unused]] void set_source(std::string source);
 
+    /**
+     * Set the number of decompression threads, all readers share one htslib thread pool
+     * @param num_threads number of threads, 0 means no extra threads
+     */
+    [[maybe_unused]] void set_threads(int num_threads);
+    [[maybe_unused]] [[nodiscard]] auto get_threads() const -> int;
+
+    /**
+     * Decode info of records only on first access, records which are only filtered by chrom, pos
+     * or rlen skip unpacking info. Info of a copied record must be accessed before the reader
+     * moves to the next record.
+     * @param lazy_info true to defer info decoding
+     */
+    [[maybe_unused]] void set_lazy_info(bool lazy_info);
+
+    /**
+     * Parse the header once and return a cursor sharing it, copies of the returned ranges can
+     * be handed to worker threads without opening and parsing the file again.
+     * @return copy of this ranges
+     */
+    [[nodiscard]] auto share() const -> VcfRanges;
+
+    /**
+     * Split a bgzipped vcf at bgzf block and line boundaries, every chunk is read by its own
+     * cursor and can be iterated independently. Bcf and uncompressed files are one chunk.
+     * @param n_chunks max number of chunks, small files may give fewer chunks
+     * @return chunks in file order
+     */
+    [[nodiscard]] auto chunks(std::size_t n_chunks) const -> std::vector<chunk_ranges>;
+
+    /**
+     * Read chunks of the file in parallel, one thread for every chunk
+     * @param fn called with (chunk index, record) or (record) from worker threads, records of
+     * one chunk are passed in file order
+     */
+    template <typename Fn> void parallel_for_each(std::size_t n_chunks, Fn fn) const;
+    [[maybe_unused]] [[nodiscard]] auto get_lazy_info() const -> bool;
+
   private:
+    auto handle() const -> std::shared_ptr<details::VcfHandle> const&;
     constexpr void seek() const;
     constexpr auto check_query(std::string_view chrom) const -> int;
+    static void read_text_if_plain(details::DataImpl& data, std::string const& file_path);
 
     std::string file_path_{};
     mutable std::shared_ptr<details::DataImpl> pdata_{nullptr};
+    mutable std::shared_ptr<details::VcfHandle> handle_{nullptr};
     std::string source_{};
+    int num_threads_{0};
+    bool lazy_info_{false};
   };
 
   template <RecordConcept RecordType>
@@ -465,6 +1296,87 @@ namespace binary::parser::vcf {
     return source_;
   }
 
+  template <RecordConcept RecordType>
+  [[maybe_unused]] void VcfRanges<RecordType>::set_threads(int num_threads) {
+    num_threads_ = num_threads;
+  }
+
+  template <RecordConcept RecordType>
+  [[maybe_unused]] auto VcfRanges<RecordType>::get_threads() const -> int {
+    return num_threads_;
+  }
+
+  template <RecordConcept RecordType> auto VcfRanges<RecordType>::handle() const
+      -> std::shared_ptr<details::VcfHandle> const& {
+    if (handle_ == nullptr) handle_ = std::make_shared<details::VcfHandle>(file_path_);
+    return handle_;
+  }
+
+  template <RecordConcept RecordType> auto VcfRanges<RecordType>::share() const -> VcfRanges {
+    static_cast<void>(handle());
+    return *this;
+  }
+
+  template <RecordConcept RecordType>
+  auto VcfRanges<RecordType>::chunks(std::size_t n_chunks) const -> std::vector<chunk_ranges> {
+    auto header_end = handle()->header_end();
+    if (handle_->is_bcf() || header_end < 0) return {chunk_ranges{*this, -1, -1, true}};
+
+    // chunk i reads lines starting in (begin_i, begin_i+1], blocks start at uncompressed offset 0
+    auto begins = std::vector<int64_t>{header_end};
+    for (auto offset : details::bgzf_split_offsets(file_path_, header_end >> 16, n_chunks)) {
+      if (offset > (header_end >> 16)) begins.push_back(offset << 16);
+    }
+
+    auto res = std::vector<chunk_ranges>{};
+    for (std::size_t i = 0; i < begins.size(); ++i) {
+      auto end = i + 1 < begins.size() ? begins[i + 1] : std::numeric_limits<int64_t>::max();
+      res.emplace_back(*this, begins[i], end, i == 0);
+    }
+    return res;
+  }
+
+  template <RecordConcept RecordType>
+  template <typename Fn>
+  void VcfRanges<RecordType>::parallel_for_each(std::size_t n_chunks, Fn fn) const {
+    auto chunk_list = chunks(n_chunks);
+    auto errors = std::vector<std::exception_ptr>(chunk_list.size());
+
+    {
+      auto workers = std::vector<std::jthread>{};
+      workers.reserve(chunk_list.size());
+      for (std::size_t i = 0; i < chunk_list.size(); ++i) {
+        workers.emplace_back([&chunk_list, &errors, &fn, i] {
+          try {
+            for (auto const& record : chunk_list[i]) {
+              if constexpr (std::invocable<Fn&, std::size_t, RecordType const&>) {
+                fn(i, record);
+              } else {
+                fn(record);
+              }
+            }
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        });
+      }
+    }
+
+    for (auto const& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  }
+
+  template <RecordConcept RecordType>
+  [[maybe_unused]] void VcfRanges<RecordType>::set_lazy_info(bool lazy_info) {
+    lazy_info_ = lazy_info;
+  }
+
+  template <RecordConcept RecordType>
+  [[maybe_unused]] auto VcfRanges<RecordType>::get_lazy_info() const -> bool {
+    return lazy_info_;
+  }
+
   template <RecordConcept RecordType> VcfRanges<RecordType>::VcfRanges(std::string file_path)
       : file_path_(std::move(file_path)) {}
 
@@ -483,95 +1395,89 @@ namespace binary::parser::vcf {
    */
   template <RecordConcept RecordType> constexpr auto VcfRanges<RecordType>::has_read_index() const
       -> bool {
-    return pdata_ == nullptr ? false : pdata_->idx_ptr != nullptr;
+    if (pdata_ == nullptr) return false;
+    return pdata_->idx_ptr != nullptr || pdata_->bcf_idx_ptr != nullptr;
   }
 
   template <RecordConcept RecordType>
   constexpr auto VcfRanges<RecordType>::check_query(std::string_view chrom) const -> int {
     if (!has_index_file()) throw VcfReaderError("Cannot find index file for " + file_path_);
-    if (!has_read_index()) {
-      if (pdata_->idx_ptr.reset(tbx_index_load(file_path_.c_str())); !pdata_->idx_ptr) {
-        throw VcfReaderError("Failed to load index for " + file_path_);
-      }
-    }
 
-    if (bcf_hdr_name2id(pdata_->header.get(), chrom.data()) < 0) {
-      throw VcfReaderError(std::string(chrom) + " is not in the vcf file " + file_path_);
+    auto chrom_name = std::string(chrom);
+    auto rid = bcf_hdr_name2id(pdata_->header.get(), chrom_name.c_str());
+    if (rid < 0) throw VcfReaderError(chrom_name + " is not in the vcf file " + file_path_);
+
+    if (handle_->is_bcf()) {
+      // bcf is indexed by csi with the contig ids of the header
+      pdata_->bcf_idx_ptr = handle_->bcf_index();
+      return rid;
     }
-    auto tid = tbx_name2id(pdata_->idx_ptr.get(), chrom.data());
-    //    assert(tid > 0);
-    return tid;
-  }
 
-  template <RecordConcept RecordType>
-  constexpr auto VcfRanges<RecordType>::iter_query_record() const -> VcfRanges::iterator {
-    if (int ret = tbx_itr_next(pdata_->fp.get(), pdata_->idx_ptr.get(), pdata_->itr_ptr.get(),
-                               pdata_->ks_ptr.get());
-        ret < -1) {
-      throw VcfReaderError("Query-> Failed to query ");
-    } else if (ret == -1) {
-      return iterator{};
-    }
-    // no problem
-
-    vcf_parse1(pdata_->ks_ptr.get(), pdata_->header.get(), pdata_->record.get());
-    return iterator(pdata_);
-  }
+    // tabix also loads csi index of bgzipped vcf
+    pdata_->idx_ptr = handle_->tbx_index();
 
-  // FIXME: query cannot work as expected
+    // -1 if the chromosome has no record
+    return tbx_name2id(pdata_->idx_ptr.get(), chrom_name.c_str());
+  }
 
   /**
    * @brief  query the vcf file if has index
    * @param chrom chromosome name
    * @param start start position
    * @param end end position
-   * @return vcf record
+   * @return vcf records overlapping the region
    */
   template <RecordConcept RecordType>
-  constexpr auto VcfRanges<RecordType>::query(std::string_view chrom, pos_t start, pos_t end) const
-      -> VcfRanges::iterator {
+  auto VcfRanges<RecordType>::query(std::string_view chrom, pos_t start, pos_t end) const
+      -> query_ranges {
     seek();  // reset pdata_
 
     auto tid = check_query(chrom);  // may throw error
-    pdata_->itr_ptr.reset(tbx_itr_queryi(pdata_->idx_ptr.get(), tid, start, end));
-
-    if (!pdata_->itr_ptr) {
-      throw VcfReaderError("Query-> Failed to query " + std::string(chrom) + ":"
-                           + std::to_string(start) + "-" + std::to_string(end));
-    }
-    return iter_query_record();
+    return query_ranges{pdata_, source_, tid, start, end};
   }
 
   template <RecordConcept RecordType>
-  constexpr auto VcfRanges<RecordType>::query(std::string_view chrom) const -> VcfRanges::iterator {
+  auto VcfRanges<RecordType>::query(std::string_view chrom) const -> query_ranges {
     seek();  //  reset pdata_
 
-    check_query(chrom);  // may throw error
-    pdata_->itr_ptr.reset(tbx_itr_querys(pdata_->idx_ptr.get(), chrom.data()));
-
-    if (!pdata_->itr_ptr) {
-      throw VcfReaderError("Query-> Failed to query " + std::string(chrom));
-    }
-    return iter_query_record();
+    auto tid = check_query(chrom);  // may throw error
+    return query_ranges{pdata_, source_, tid, 0, HTS_POS_MAX};
   }
 
   template <RecordConcept RecordType> constexpr auto VcfRanges<RecordType>::begin() const
       -> VcfRanges::iterator {
     seek();
+    read_text_if_plain(*pdata_, file_path_);
     return iterator{pdata_, source_};
   }
 
+  /**
+   * @brief tokenize lines of a plain vcf file with VcfTextReader instead of htslib
+   *
+   * Only records with info of TextInfoFieldConcept are read this way, htslib still reads the
+   * header and the records of other files.
+   */
+  template <RecordConcept RecordType>
+  void VcfRanges<RecordType>::read_text_if_plain(details::DataImpl& data,
+                                                  std::string const& file_path) {
+    if constexpr (requires { requires RecordType::is_text_readable; }) {
+      if (data.is_plain_text()) data.text.emplace(file_path);
+    }
+  }
+
   template <RecordConcept RecordType> constexpr auto VcfRanges<RecordType>::end() const
       -> std::default_sentinel_t {
     return std::default_sentinel;
   }
   template <RecordConcept RecordType> constexpr void VcfRanges<RecordType>::seek() const {
-    pdata_ = std::make_shared<details::DataImpl>(file_path_);
+    pdata_ = handle()->open(num_threads_);
+    pdata_->lazy_info = lazy_info_;
   }
 
   template <RecordConcept RecordType> constexpr auto VcfRanges<RecordType>::has_index_file() const
       -> bool {
-    return binary::utils::check_file_path(file_path_ + ".tbi");
+    return binary::utils::check_file_path(file_path_ + ".tbi")
+           || binary::utils::check_file_path(file_path_ + ".csi");
   }
 
   template <RecordConcept RecordType> auto VcfRanges<RecordType>::chroms() const
@@ -621,6 +1527,10 @@ namespace binary::parser::vcf {
                     RecordType&& vcf_record)
         : tree::UIntInterval(low_, high_), record(std::move(vcf_record)) {}
 
+    BaseVcfInterval(tree::UIntInterval::key_type low_, tree::UIntInterval::key_type high_,
+                    RecordType const& vcf_record)
+        : tree::UIntInterval(low_, high_), record(vcf_record) {}
+
     using tree::UIntInterval::UIntInterval;
 
     BaseVcfInterval(BaseVcfInterval const& other) = default;
@@ -0,0 +1,94 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_BATCH_HPP_
+#define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_BATCH_HPP_
+
+#include <binary/parser/contig.hpp>
+#include <binary/parser/vcf.hpp>
+#include <binary/parser/vcf_text.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace binary::parser::vcf {
+
+  enum class SvType : std::uint8_t { Unknown, Del, Ins, Dup, Tdup, Idup, Inv, Tra, Bnd };
+
+  [[nodiscard]] auto to_svtype(std::string_view svtype) noexcept -> SvType;
+  [[nodiscard]] auto to_string(SvType svtype) noexcept -> std::string_view;
+
+  /**
+   * @brief info keys read into the columns of a batch
+   *
+   * Missing end falls back to the end of the record, missing chr2 is an empty contig and
+   * missing strands are positive.
+   */
+  struct VcfBatchKeys {
+    std::string svtype{"SVTYPE"};
+    std::string end{"END"};
+    std::string chr2{"CHR2"};
+    std::string strand1{"STRAND1"};
+    std::string strand2{"STRAND2"};
+  };
+
+  /**
+   * @brief records stored column by column, row i of every column is the same record
+   */
+  struct VcfBatch {
+    static constexpr std::uint8_t STRAND1_POSITIVE = 0x1;
+    static constexpr std::uint8_t STRAND2_POSITIVE = 0x2;
+
+    std::vector<Contig> chroms{};
+    std::vector<pos_t> pos{};  // 0-based
+    std::vector<pos_t> end{};  // 1-based, value of the end key
+    std::vector<SvType> svtypes{};
+    std::vector<Contig> chr2s{};
+    std::vector<std::uint8_t> strands{};  // bits of STRAND1_POSITIVE and STRAND2_POSITIVE
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return pos.size(); }
+    [[nodiscard]] auto empty() const noexcept -> bool { return pos.empty(); }
+
+    void clear() noexcept;
+    void reserve(std::size_t capacity);
+  };
+
+  /**
+   * @brief read records of a vcf file into batches without building record objects
+   *
+   * Uncompressed vcf files are memory mapped and tokenized directly, only CHROM, POS, REF and
+   * the info keys of the batch are decoded. Other files are read by htslib.
+   */
+  class VcfBatchReader {
+  public:
+    explicit VcfBatchReader(std::string const& file_path, VcfBatchKeys keys = {},
+                            int num_threads = 0);
+
+    /**
+     * @brief replace content of batch with the next records
+     * @param batch batch to fill, capacity of columns is kept between calls
+     * @param max_records max number of records to read
+     * @return number of records read, 0 at the end of file
+     */
+    auto read_batch(VcfBatch& batch, std::size_t max_records) -> std::size_t;
+
+    [[nodiscard]] auto eof() const noexcept -> bool { return eof_; }
+
+  private:
+    void append(VcfBatch& batch);
+    void append(VcfBatch& batch, VcfTextLine const& line);
+
+    std::shared_ptr<details::DataImpl> data_{nullptr};
+    std::optional<VcfTextReader> text_{};
+    VcfBatchKeys keys_{};
+    details::InfoKeyIds<5> key_ids_{};
+    bool eof_{false};
+  };
+
+}  // namespace binary::parser::vcf
+
+#endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_BATCH_HPP_
@@ -0,0 +1,97 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_TEXT_HPP_
+#define BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_TEXT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace binary::parser::vcf {
+  using pos_t = std::uint32_t;
+
+  /**
+   * @brief read-only memory map of a whole file, the file is not copied into memory
+   */
+  class MappedFile {
+  public:
+    constexpr MappedFile() = default;
+    explicit MappedFile(std::string const& file_path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    auto operator=(MappedFile const&) -> MappedFile& = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+
+    [[nodiscard]] auto view() const noexcept -> std::string_view {
+      return {static_cast<char const*>(data_), size_};
+    }
+
+  private:
+    void* data_{nullptr};
+    std::size_t size_{0};
+  };
+
+  /**
+   * @brief fields of one data line, views into the mapped file
+   */
+  struct VcfTextLine {
+    std::string_view chrom{};
+    pos_t pos{};  // 0-based
+    std::string_view ref{};
+    std::string_view info{};
+  };
+
+  /**
+   * @brief tokenizer of uncompressed vcf files
+   *
+   * Lines and tabs are found with memchr, only CHROM, POS, REF and INFO are split out of a
+   * line. Other columns and the header are skipped without parsing.
+   */
+  class VcfTextReader {
+  public:
+    explicit VcfTextReader(std::string const& file_path);
+
+    /**
+     * @brief read next data line
+     * @return false at the end of file
+     */
+    auto next(VcfTextLine& line) -> bool;
+
+    [[nodiscard]] auto eof() const noexcept -> bool { return offset_ >= file_.view().size(); }
+
+    /**
+     * @brief find value of key in INFO column without decoding other keys
+     *
+     * Entry boundaries are located with avx2 or sse2 when the cpu has them, multiple values of
+     * a key are returned as they are written.
+     * @return empty view for flags, std::nullopt if key is missing
+     */
+    [[nodiscard]] static auto find_info(std::string_view info, std::string_view key) noexcept
+        -> std::optional<std::string_view>;
+
+    /**
+     * @brief same as find_info without simd, used to check the simd scanners
+     */
+    [[nodiscard]] static auto find_info_scalar(std::string_view info,
+                                               std::string_view key) noexcept
+        -> std::optional<std::string_view>;
+
+  private:
+    MappedFile file_{};
+    std::size_t offset_{0};
+  };
+
+  /**
+   * @return true if file is vcf text, false for bgzf, gzip and bcf files
+   */
+  [[nodiscard]] auto is_plain_vcf(std::string const& file_path) -> bool;
+
+}  // namespace binary::parser::vcf
+
+#endif  // BUILDALL_LIBRARY_INCLUDE_BINARY_PARSER_VCF_TEXT_HPP_
@@ -7,9 +7,13 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <ranges>
+#include <string>
+#include <vector>
 
 namespace binary::utils {
 
@@ -38,33 +42,45 @@ namespace binary::utils {
         (spdlog::trace("std::tuple values {} ", std::get<T>(tup)), 0)...};
   }
 
+  /**
+   * @brief append bytes [offset, offset + count) of file to output_fd at its current position
+   *
+   * Bytes are copied in the kernel with copy_file_range or sendfile, large buffered copies are
+   * used when neither is supported between the two files.
+   * @return number of bytes appended, less than count if file ends before
+   * @throws std::filesystem::filesystem_error if file can not be read or output_fd written
+   */
+  auto append_file(int output_fd, std::string const& file, std::uint64_t offset = 0,
+                   std::uint64_t count = std::numeric_limits<std::uint64_t>::max())
+      -> std::uint64_t;
+
+  /**
+   * @return size of the first line of file including '\n', size of file if it has one line
+   */
+  auto first_line_size(std::string const& file) -> std::uint64_t;
+
+  namespace details {
+    void merge_files(std::vector<std::string> const& files, std::string_view output_file,
+                     std::string_view header, bool is_deleted, bool is_skipped_header);
+  }  // namespace details
+
+  /**
+   * @brief concatenate files after header, files are appended without passing through memory
+   *
+   * An output ending in .gz or .bgz is a bgzf file and every file must be bgzf too. Their blocks
+   * are copied without recompression, only the block a skipped header ends in is recompressed.
+   * The eof block of every file is dropped and one is written at the end of the output.
+   * @param is_skipped_header skip the first line of every file
+   * @throws std::filesystem::filesystem_error if a file can not be read, or is bgzf when the
+   * output is not or the other way around
+   */
   template <std::ranges::input_range StringRange>
   requires std::convertible_to<std::ranges::range_value_t<StringRange>, std::string>
   void merge_files(StringRange&& files, std::string_view output_file, std::string_view header = "",
                    bool is_deleted = true, bool is_skipped_header = true) {
-    auto output = std::ofstream(output_file.data());
-
-    if (!header.empty()) {
-      output << header << '\n';
-    }
-
-    for (auto const& file : files) {
-      // check files exist
-      if (std::filesystem::exists(file)) {
-        auto input = std::ifstream(file);
-        if (is_skipped_header) {
-          std::string line;
-          std::getline(input, line);
-        }
-        output << input.rdbuf();
-        input.close();
-        // remove original files
-        if (is_deleted) {
-          std::filesystem::remove(file);
-        }
-      }
-    }
-    output.close();
+    auto file_list = std::vector<std::string>{};
+    for (auto const& file : files) file_list.emplace_back(file);
+    details::merge_files(file_list, output_file, header, is_deleted, is_skipped_header);
   }
 
   [[maybe_unused]] inline void set_debug() { spdlog::set_level(spdlog::level::debug); }
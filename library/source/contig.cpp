@@ -0,0 +1,56 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include <binary/parser/contig.hpp>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace binary::parser {
+
+  namespace {
+    // entries are never removed, so pointers held by contigs stay valid
+    struct ContigRegistry {
+      std::shared_mutex mutex{};
+      std::deque<Contig::Entry> entries{};
+      std::unordered_map<std::string_view, Contig::Entry const*> lookup{};
+    };
+
+    auto registry() -> ContigRegistry& {
+      static ContigRegistry instance{};
+      return instance;
+    }
+  }  // namespace
+
+  Contig::Contig(std::string_view name) {
+    if (name.empty()) return;
+
+    auto& reg = registry();
+    {
+      std::shared_lock lock{reg.mutex};
+      if (auto iter = reg.lookup.find(name); iter != reg.lookup.end()) {
+        entry_ = iter->second;
+        return;
+      }
+    }
+
+    std::unique_lock lock{reg.mutex};
+    if (auto iter = reg.lookup.find(name); iter != reg.lookup.end()) {
+      entry_ = iter->second;
+      return;
+    }
+    auto& entry = reg.entries.emplace_back(
+        Entry{std::string(name), static_cast<std::int32_t>(reg.entries.size())});
+    reg.lookup.emplace(std::string_view{entry.name}, &entry);
+    entry_ = &entry;
+  }
+
+  auto Contig::interned_size() -> std::size_t {
+    auto& reg = registry();
+    std::shared_lock lock{reg.mutex};
+    return reg.entries.size();
+  }
+
+}  // namespace binary::parser
@@ -2,10 +2,275 @@
 // Created by li002252 on 8/1/22.
 //
 
+#include <fcntl.h>
+#include <htslib/bgzf.h>
+#include <htslib/kstring.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#  include <sys/sendfile.h>
+#endif
+
+#include <array>
 #include <binary/utils.hpp>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <system_error>
 
 namespace binary::utils {
 
+  namespace {
+    // buffered copies read whole pages into a page aligned buffer
+    constexpr std::size_t COPY_BUFFER_SIZE = 1 << 20;
+    constexpr std::size_t COPY_BUFFER_ALIGNMENT = 4096;
+    // the kernel copies less than 2GB per call
+    constexpr std::uint64_t MAX_KERNEL_COPY = 1 << 30;
+
+    // empty block htslib writes at the end of every bgzf file
+    constexpr std::array<unsigned char, 28> BGZF_EOF_BLOCK
+        = {0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+           0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+    [[noreturn]] void throw_file_error(std::string const& what, std::string const& file,
+                                       int error = errno) {
+      throw std::filesystem::filesystem_error(what, file,
+                                              std::error_code(error, std::generic_category()));
+    }
+
+    class UniqueFd {
+    public:
+      explicit UniqueFd(int fd) : fd_{fd} {}
+      ~UniqueFd() {
+        if (fd_ >= 0) ::close(fd_);
+      }
+      UniqueFd(UniqueFd const&) = delete;
+      auto operator=(UniqueFd const&) -> UniqueFd& = delete;
+
+      [[nodiscard]] auto get() const noexcept -> int { return fd_; }
+
+    private:
+      int fd_{-1};
+    };
+
+    void write_all(int fd, char const* data, std::size_t size, std::string const& file) {
+      while (size > 0) {
+        auto written = ::write(fd, data, size);
+        if (written < 0) {
+          if (errno == EINTR) continue;
+          throw_file_error("Failed to append", file);
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+      }
+    }
+
+    auto buffered_copy(int input_fd, std::uint64_t offset, int output_fd, std::uint64_t count,
+                       std::string const& file) -> std::uint64_t {
+      auto buffer = std::unique_ptr<char, decltype(&std::free)>(
+          static_cast<char*>(std::aligned_alloc(COPY_BUFFER_ALIGNMENT, COPY_BUFFER_SIZE)),
+          &std::free);
+      if (buffer == nullptr) throw std::bad_alloc();
+
+      std::uint64_t copied = 0;
+      while (copied < count) {
+        auto size = static_cast<std::size_t>(
+            std::min<std::uint64_t>(COPY_BUFFER_SIZE, count - copied));
+        auto read = ::pread(input_fd, buffer.get(), size, static_cast<off_t>(offset + copied));
+        if (read < 0) {
+          if (errno == EINTR) continue;
+          throw_file_error("Failed to read", file);
+        }
+        if (read == 0) break;
+        write_all(output_fd, buffer.get(), static_cast<std::size_t>(read), file);
+        copied += static_cast<std::uint64_t>(read);
+      }
+      return copied;
+    }
+
+#if defined(__linux__)
+    // errors of copy_file_range and sendfile when they can not copy between the files
+    auto is_unsupported(int error) -> bool {
+      return error == EXDEV || error == ENOSYS || error == EINVAL || error == EOPNOTSUPP;
+    }
+
+    auto kernel_copy(int input_fd, std::uint64_t offset, int output_fd, std::uint64_t count,
+                     std::string const& file) -> std::uint64_t {
+      auto input_offset = static_cast<off_t>(offset);
+      auto use_copy_file_range = true;
+      std::uint64_t copied = 0;
+
+      while (copied < count) {
+        auto size = static_cast<std::size_t>(std::min(count - copied, MAX_KERNEL_COPY));
+        auto done = use_copy_file_range
+                        ? ::copy_file_range(input_fd, &input_offset, output_fd, nullptr, size, 0)
+                        : ::sendfile(output_fd, input_fd, &input_offset, size);
+        if (done < 0) {
+          if (errno == EINTR) continue;
+          if (copied == 0 && is_unsupported(errno)) {
+            if (!use_copy_file_range) break;
+            use_copy_file_range = false;
+            continue;
+          }
+          throw_file_error("Failed to append", file);
+        }
+        if (done == 0) break;
+        copied += static_cast<std::uint64_t>(done);
+      }
+      return copied;
+    }
+#endif
+  }  // namespace
+
+  auto append_file(int output_fd, std::string const& file, std::uint64_t offset,
+                   std::uint64_t count) -> std::uint64_t {
+    auto input = UniqueFd(::open(file.c_str(), O_RDONLY));
+    if (input.get() < 0) throw_file_error("Failed to open", file);
+
+    struct stat file_stat {};
+    if (::fstat(input.get(), &file_stat) < 0) throw_file_error("Failed to stat", file);
+
+    auto const size = static_cast<std::uint64_t>(file_stat.st_size);
+    if (offset >= size) return 0;
+    count = std::min(count, size - offset);
+
+    std::uint64_t copied = 0;
+#if defined(__linux__)
+    copied = kernel_copy(input.get(), offset, output_fd, count, file);
+#endif
+    // the rest of a file the kernel can not copy
+    return copied + buffered_copy(input.get(), offset + copied, output_fd, count - copied, file);
+  }
+
+  namespace {
+    auto has_bgzf_extension(std::string_view file) -> bool {
+      return file.ends_with(".gz") || file.ends_with(".bgz");
+    }
+
+    // gzip header with the BC extra subfield every bgzf block starts with
+    auto is_bgzf_file(std::string const& file) -> bool {
+      auto input = std::ifstream(file, std::ios::binary);
+      auto header = std::array<unsigned char, 16>{};
+      input.read(reinterpret_cast<char*>(header.data()), header.size());
+      return input && header[0] == 0x1f && header[1] == 0x8b && header[2] == 0x08
+             && (header[3] & 0x04) != 0 && header[12] == 'B' && header[13] == 'C'
+             && header[14] == 0x02 && header[15] == 0x00;
+    }
+
+    /**
+     * @return size of a bgzf file without its eof block
+     */
+    auto bgzf_data_end(std::string const& file) -> std::uint64_t {
+      auto size = static_cast<std::uint64_t>(std::filesystem::file_size(file));
+      if (size < BGZF_EOF_BLOCK.size()) return size;
+
+      auto input = std::ifstream(file, std::ios::binary);
+      auto tail = std::array<unsigned char, BGZF_EOF_BLOCK.size()>{};
+      input.seekg(static_cast<std::streamoff>(size - tail.size()));
+      input.read(reinterpret_cast<char*>(tail.data()), tail.size());
+      return input && tail == BGZF_EOF_BLOCK ? size - tail.size() : size;
+    }
+
+    void write_bgzf_blocks(int output_fd, std::string_view data, std::string const& file) {
+      auto block = std::vector<char>(BGZF_MAX_BLOCK_SIZE);
+      while (!data.empty()) {
+        auto size = std::min<std::size_t>(data.size(), BGZF_BLOCK_SIZE);
+        auto block_size = block.size();
+        if (bgzf_compress(block.data(), &block_size, data.data(), size, -1) < 0) {
+          throw_file_error("Failed to compress", file, EIO);
+        }
+        write_all(output_fd, block.data(), block_size, file);
+        data.remove_prefix(size);
+      }
+    }
+
+    /**
+     * @brief append the blocks of a bgzf file to output_fd without its eof block
+     *
+     * Only the block the header ends in is decompressed, lines after the header in that block
+     * are compressed into a block of their own. Later blocks are copied as they are.
+     */
+    void append_bgzf_file(int output_fd, std::string const& file, bool is_skipped_header,
+                          std::string const& output_file) {
+      std::uint64_t begin = 0;
+      if (is_skipped_header) {
+        auto input = std::unique_ptr<BGZF, decltype(&bgzf_close)>(bgzf_open(file.c_str(), "r"),
+                                                                 &bgzf_close);
+        if (input == nullptr) throw_file_error("Failed to open", file);
+
+        auto line = kstring_t{0, 0, nullptr};
+        auto status = bgzf_getline(input.get(), '\n', &line);
+        std::free(line.s);
+        if (status < -1) throw_file_error("Failed to read", file, EIO);
+
+        auto rest = std::string(static_cast<std::size_t>(input->block_length - input->block_offset),
+                                '\0');
+        if (!rest.empty()) {
+          if (bgzf_read(input.get(), rest.data(), rest.size())
+              != static_cast<ssize_t>(rest.size())) {
+            throw_file_error("Failed to read", file, EIO);
+          }
+          write_bgzf_blocks(output_fd, rest, output_file);
+        }
+        // the block after the header
+        begin = static_cast<std::uint64_t>(bgzf_tell(input.get()) >> 16);
+      }
+
+      auto end = bgzf_data_end(file);
+      if (end > begin) append_file(output_fd, file, begin, end - begin);
+    }
+  }  // namespace
+
+  auto first_line_size(std::string const& file) -> std::uint64_t {
+    auto input = std::ifstream(file, std::ios::binary);
+    auto line = std::string{};
+    if (!std::getline(input, line)) return 0;
+    return line.size() + (input.eof() ? 0 : 1);
+  }
+
+  void details::merge_files(std::vector<std::string> const& files, std::string_view output_file,
+                            std::string_view header, bool is_deleted, bool is_skipped_header) {
+    auto const output_path = std::string(output_file);
+    auto output = UniqueFd(::open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (output.get() < 0) throw_file_error("Failed to create", output_path);
+    auto const is_bgzf = has_bgzf_extension(output_path);
+
+    if (!header.empty()) {
+      auto header_line = std::string(header) + '\n';
+      if (is_bgzf) {
+        write_bgzf_blocks(output.get(), header_line, output_path);
+      } else {
+        write_all(output.get(), header_line.data(), header_line.size(), output_path);
+      }
+    }
+
+    for (auto const& file : files) {
+      // check files exist
+      if (!std::filesystem::exists(file)) continue;
+
+      if (is_bgzf_file(file) != is_bgzf) {
+        // blocks of a bgzf file are copied as they are, so it only merges into a bgzf output
+        throw std::filesystem::filesystem_error(
+            is_bgzf ? "Failed to merge a text file into a bgzf file"
+                    : "Failed to merge a bgzf file into a text file",
+            file, output_path, std::make_error_code(std::errc::invalid_argument));
+      }
+      if (is_bgzf) {
+        append_bgzf_file(output.get(), file, is_skipped_header, output_path);
+      } else {
+        auto offset = is_skipped_header ? first_line_size(file) : 0;
+        append_file(output.get(), file, offset);
+      }
+      // remove original files
+      if (is_deleted) std::filesystem::remove(file);
+    }
+
+    if (is_bgzf) {
+      write_all(output.get(), reinterpret_cast<char const*>(BGZF_EOF_BLOCK.data()),
+                BGZF_EOF_BLOCK.size(), output_path);
+    }
+  }
+
   auto check_file_path(std::initializer_list<std::string_view> file_paths) -> bool {
     for (auto const& file_path : file_paths) {
       if (!std::filesystem::is_regular_file(file_path)) {
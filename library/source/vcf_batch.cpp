@@ -0,0 +1,148 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include <array>
+#include <binary/parser/vcf_batch.hpp>
+#include <charconv>
+#include <utility>
+
+namespace binary::parser::vcf {
+
+  namespace {
+    constexpr std::array<std::pair<std::string_view, SvType>, 8> SVTYPE_NAMES{{
+        {"DEL", SvType::Del},
+        {"INS", SvType::Ins},
+        {"DUP", SvType::Dup},
+        {"TDUP", SvType::Tdup},
+        {"IDUP", SvType::Idup},
+        {"INV", SvType::Inv},
+        {"TRA", SvType::Tra},
+        {"BND", SvType::Bnd},
+    }};
+  }  // namespace
+
+  auto to_svtype(std::string_view svtype) noexcept -> SvType {
+    for (auto const& [name, type] : SVTYPE_NAMES) {
+      if (name == svtype) return type;
+    }
+    return SvType::Unknown;
+  }
+
+  auto to_string(SvType svtype) noexcept -> std::string_view {
+    for (auto const& [name, type] : SVTYPE_NAMES) {
+      if (type == svtype) return name;
+    }
+    return "UNKNOWN";
+  }
+
+  void VcfBatch::clear() noexcept {
+    chroms.clear();
+    pos.clear();
+    end.clear();
+    svtypes.clear();
+    chr2s.clear();
+    strands.clear();
+  }
+
+  void VcfBatch::reserve(std::size_t capacity) {
+    chroms.reserve(capacity);
+    pos.reserve(capacity);
+    end.reserve(capacity);
+    svtypes.reserve(capacity);
+    chr2s.reserve(capacity);
+    strands.reserve(capacity);
+  }
+
+  VcfBatchReader::VcfBatchReader(std::string const& file_path, VcfBatchKeys keys, int num_threads)
+      : keys_{std::move(keys)} {
+    if (is_plain_vcf(file_path)) {
+      text_.emplace(file_path);
+    } else {
+      data_ = std::make_shared<details::DataImpl>(file_path, num_threads);
+    }
+  }
+
+  auto VcfBatchReader::read_batch(VcfBatch& batch, std::size_t max_records) -> std::size_t {
+    batch.clear();
+    batch.reserve(max_records);
+
+    if (text_) {
+      auto line = VcfTextLine{};
+      while (!eof_ && batch.size() < max_records) {
+        if (text_->next(line)) {
+          append(batch, line);
+        } else {
+          eof_ = true;
+        }
+      }
+      return batch.size();
+    }
+
+    while (!eof_ && batch.size() < max_records) {
+      if (int ret = data_->read(); ret < -1) {
+        throw VcfReaderError("Failed to read line in vcf ");
+      } else if (ret == -1) {
+        eof_ = true;
+      } else {
+        append(batch);
+      }
+    }
+    return batch.size();
+  }
+
+  void VcfBatchReader::append(VcfBatch& batch) {
+    auto const keys = std::array<std::string_view, 5>{keys_.svtype, keys_.end, keys_.chr2,
+                                                      keys_.strand1, keys_.strand2};
+    auto const& ids = key_ids_.resolve(*data_, keys);
+    auto& data = *data_;
+    auto* record = data.record.get();
+
+    // flag lookup tells whether the key is present without decoding its value
+    auto has = [&](std::size_t i) { return data.info<bool>(ids[i], keys[i]); };
+    auto positive
+        = [&](std::size_t i) { return !has(i) || data.info<char>(ids[i], keys[i]) == "+"; };
+
+    auto pos = static_cast<pos_t>(record->pos);
+    batch.chroms.push_back(data.contig(record->rid));
+    batch.pos.push_back(pos);
+    batch.end.push_back(has(1) ? data.info<pos_t>(ids[1], keys[1])
+                               : pos + static_cast<pos_t>(record->rlen));
+    batch.svtypes.push_back(has(0) ? to_svtype(data.info<char>(ids[0], keys[0]))
+                                   : SvType::Unknown);
+    batch.chr2s.push_back(has(2) ? Contig{data.info<char>(ids[2], keys[2])} : Contig{});
+    batch.strands.push_back(static_cast<std::uint8_t>(
+        (positive(3) ? VcfBatch::STRAND1_POSITIVE : 0)
+        | (positive(4) ? VcfBatch::STRAND2_POSITIVE : 0)));
+  }
+
+  void VcfBatchReader::append(VcfBatch& batch, VcfTextLine const& line) {
+    auto info
+        = [&line](std::string const& key) { return VcfTextReader::find_info(line.info, key); };
+    auto positive = [&info](std::string const& key) {
+      auto strand = info(key);
+      return !strand || *strand == "+";
+    };
+
+    // same fallback as htslib, a record without end spans its reference allele
+    auto end = line.pos + static_cast<pos_t>(line.ref.size());
+    if (auto value = info(keys_.end); value) {
+      auto [ptr, ec] = std::from_chars(value->data(), value->data() + value->size(), end);
+      if (ec != std::errc{}) {
+        throw VcfReaderError("Invalid " + keys_.end + " of " + std::string(line.chrom));
+      }
+    }
+
+    auto svtype = info(keys_.svtype);
+    auto chr2 = info(keys_.chr2);
+    batch.chroms.emplace_back(line.chrom);
+    batch.pos.push_back(line.pos);
+    batch.end.push_back(end);
+    batch.svtypes.push_back(svtype ? to_svtype(*svtype) : SvType::Unknown);
+    batch.chr2s.push_back(chr2 ? Contig{*chr2} : Contig{});
+    batch.strands.push_back(static_cast<std::uint8_t>(
+        (positive(keys_.strand1) ? VcfBatch::STRAND1_POSITIVE : 0)
+        | (positive(keys_.strand2) ? VcfBatch::STRAND2_POSITIVE : 0)));
+  }
+
+}  // namespace binary::parser::vcf
@@ -0,0 +1,234 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define BINARY_INFO_SCAN_X86 1
+#  include <immintrin.h>
+#else
+#  define BINARY_INFO_SCAN_X86 0
+#endif
+
+#include <array>
+#include <binary/exception.hpp>
+#include <binary/parser/vcf_text.hpp>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace binary::parser::vcf {
+
+  MappedFile::MappedFile(std::string const& file_path) {
+    int fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) throw VcfReaderError("Failed to open " + file_path);
+
+    struct stat file_stat {};
+    if (::fstat(fd, &file_stat) < 0) {
+      ::close(fd);
+      throw VcfReaderError("Failed to stat " + file_path);
+    }
+
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ > 0) {
+      data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        ::close(fd);
+        throw VcfReaderError("Failed to map " + file_path);
+      }
+      // lines are read front to back, let the kernel read ahead
+      ::madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+  }
+
+  MappedFile::~MappedFile() {
+    if (data_ != nullptr) ::munmap(data_, size_);
+  }
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+      : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+  auto MappedFile::operator=(MappedFile&& other) noexcept -> MappedFile& {
+    if (this != &other) {
+      if (data_ != nullptr) ::munmap(data_, size_);
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  namespace {
+    // memchr is vectorized by libc, it is much faster than a byte loop on long lines
+    auto find_char(std::string_view text, char c) noexcept -> std::size_t {
+      auto const* found = static_cast<char const*>(std::memchr(text.data(), c, text.size()));
+      return found == nullptr ? text.size() : static_cast<std::size_t>(found - text.data());
+    }
+
+    // columns of a data line used by the tokenizer
+    constexpr std::size_t CHROM = 0;
+    constexpr std::size_t POS = 1;
+    constexpr std::size_t REF = 3;
+    constexpr std::size_t INFO = 7;
+
+    using InfoValue = std::optional<std::string_view>;
+    using InfoScanner = InfoValue (*)(std::string_view, std::string_view) noexcept;
+
+    // value of key if an entry of info starts with key at pos
+    auto value_at(std::string_view info, std::size_t pos, std::string_view key) noexcept
+        -> InfoValue {
+      if (info.compare(pos, key.size(), key) != 0) return std::nullopt;
+
+      auto end = pos + key.size();
+      if (end == info.size() || info[end] == ';') return std::string_view{};
+      if (info[end] != '=') return std::nullopt;
+
+      auto value = info.substr(end + 1);
+      return value.substr(0, find_char(value, ';'));
+    }
+
+    // entries after the first one start after ';', only those positions are compared to key
+    auto scan_from(std::string_view info, std::string_view key, std::size_t from) noexcept
+        -> InfoValue {
+      for (auto i = from; i < info.size(); ++i) {
+        if (info[i] == key.front() && info[i - 1] == ';') {
+          if (auto value = value_at(info, i, key); value) return value;
+        }
+      }
+      return std::nullopt;
+    }
+
+    auto scan_scalar(std::string_view info, std::string_view key) noexcept -> InfoValue {
+      return scan_from(info, key, 1);
+    }
+
+#if BINARY_INFO_SCAN_X86
+    // candidates are bytes equal to the first byte of key which follow a ';'
+    auto scan_sse2(std::string_view info, std::string_view key) noexcept -> InfoValue {
+      auto const first = _mm_set1_epi8(key.front());
+      auto const separator = _mm_set1_epi8(';');
+
+      std::size_t i = 1;
+      for (; i + 16 <= info.size(); i += 16) {
+        auto current = _mm_loadu_si128(reinterpret_cast<__m128i const*>(info.data() + i));
+        auto previous = _mm_loadu_si128(reinterpret_cast<__m128i const*>(info.data() + i - 1));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(current, first), _mm_cmpeq_epi8(previous, separator))));
+        for (; mask != 0; mask &= mask - 1) {
+          auto pos = i + static_cast<std::size_t>(__builtin_ctz(mask));
+          if (auto value = value_at(info, pos, key); value) return value;
+        }
+      }
+      return scan_from(info, key, i);
+    }
+
+    __attribute__((target("avx2"))) auto scan_avx2(std::string_view info,
+                                                   std::string_view key) noexcept -> InfoValue {
+      auto const first = _mm256_set1_epi8(key.front());
+      auto const separator = _mm256_set1_epi8(';');
+
+      std::size_t i = 1;
+      for (; i + 32 <= info.size(); i += 32) {
+        auto current = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(info.data() + i));
+        auto previous = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(info.data() + i - 1));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(current, first), _mm256_cmpeq_epi8(previous, separator))));
+        for (; mask != 0; mask &= mask - 1) {
+          auto pos = i + static_cast<std::size_t>(__builtin_ctz(mask));
+          if (auto value = value_at(info, pos, key); value) return value;
+        }
+      }
+      return scan_from(info, key, i);
+    }
+#endif
+
+    auto select_info_scanner() noexcept -> InfoScanner {
+#if BINARY_INFO_SCAN_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) return scan_avx2;
+      // sse2 is part of x86-64
+      return scan_sse2;
+#else
+      return scan_scalar;
+#endif
+    }
+  }  // namespace
+
+  VcfTextReader::VcfTextReader(std::string const& file_path) : file_{file_path} {}
+
+  auto VcfTextReader::next(VcfTextLine& line) -> bool {
+    auto const text = file_.view();
+
+    while (offset_ < text.size()) {
+      auto rest = text.substr(offset_);
+      auto row = rest.substr(0, find_char(rest, '\n'));
+      offset_ += row.size() + 1;
+
+      if (!row.empty() && row.back() == '\r') row.remove_suffix(1);
+      if (row.empty() || row.front() == '#') continue;
+
+      // only columns up to INFO are split, the rest of the line is never scanned
+      auto columns = std::array<std::string_view, INFO + 1>{};
+      for (std::size_t i = 0; i <= INFO; ++i) {
+        auto tab = find_char(row, '\t');
+        columns[i] = row.substr(0, tab);
+        if (tab == row.size() && i < INFO) {
+          throw VcfReaderError("Too few columns in vcf line of " + std::string(columns[CHROM]));
+        }
+        row.remove_prefix(tab == row.size() ? tab : tab + 1);
+      }
+
+      pos_t pos{};
+      auto const pos_column = columns[POS];
+      auto const* pos_end = pos_column.data() + pos_column.size();
+      auto [ptr, ec] = std::from_chars(pos_column.data(), pos_end, pos);
+      if (ec != std::errc{} || ptr != pos_end || pos == 0) {
+        throw VcfReaderError("Invalid position " + std::string(pos_column) + " of "
+                             + std::string(columns[CHROM]));
+      }
+
+      line.chrom = columns[CHROM];
+      line.pos = pos - 1;
+      line.ref = columns[REF];
+      line.info = columns[INFO];
+      return true;
+    }
+    return false;
+  }
+
+  auto VcfTextReader::find_info(std::string_view info, std::string_view key) noexcept
+      -> std::optional<std::string_view> {
+    if (key.empty() || info.empty()) return std::nullopt;
+    // the first entry is the only one without ';' before it
+    if (auto value = value_at(info, 0, key); value) return value;
+
+    static InfoScanner const scan = select_info_scanner();
+    return scan(info, key);
+  }
+
+  auto VcfTextReader::find_info_scalar(std::string_view info, std::string_view key) noexcept
+      -> std::optional<std::string_view> {
+    if (key.empty() || info.empty()) return std::nullopt;
+    if (auto value = value_at(info, 0, key); value) return value;
+    return scan_scalar(info, key);
+  }
+
+  auto is_plain_vcf(std::string const& file_path) -> bool {
+    auto input = std::ifstream(file_path, std::ios::binary);
+    auto magic = std::array<char, 3>{};
+    if (!input.read(magic.data(), magic.size())) return true;
+
+    auto const is_gzip = static_cast<unsigned char>(magic[0]) == 0x1f
+                         && static_cast<unsigned char>(magic[1]) == 0x8b;
+    auto const is_bcf = std::string_view{magic.data(), magic.size()} == "BCF";
+    return !is_gzip && !is_bcf;
+  }
+
+}  // namespace binary::parser::vcf
@@ -62,18 +62,18 @@ namespace sv2nl {
     return res;
   }
 
-  inline std::string get_chr2(const Sv2nlVcfRecord& record) {
+  inline vcf::Contig get_chr2(const Sv2nlVcfRecord& record) {
     assert(record.info->svtype == "TRA" || record.info->svtype == "BND");
     return record.info->chr2;
   }
 
-  inline std::pair<std::string, std::string> get_2chroms(const Sv2nlVcfRecord& record) {
+  inline std::pair<vcf::Contig, vcf::Contig> get_2chroms(const Sv2nlVcfRecord& record) {
     auto chr2 = get_chr2(record);
     return record.chrom > chr2 ? std::make_pair(chr2, record.chrom)
                                : std::make_pair(record.chrom, chr2);
   }
 
-  inline std::tuple<std::string, vcf::pos_t, std::string, vcf::pos_t> get_2chroms_with_pos(
+  inline std::tuple<vcf::Contig, vcf::pos_t, vcf::Contig, vcf::pos_t> get_2chroms_with_pos(
       const Sv2nlVcfRecord& record) {
     auto chr2 = get_chr2(record);
     return record.chrom > chr2
@@ -8,13 +8,14 @@
 // #include <thread_pool/thread_pool.h>
 #include <array>
 #include <filesystem>
-#include <initializer_list>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "helper.hpp"
 #include "options.hpp"
+#include "partitions.hpp"
 #include "thread_pool.hpp"
 #include "threadsafe_map.hpp"
 #include "vcf_info.hpp"
@@ -27,6 +28,16 @@ namespace sv2nl {
   using ThreadPool = dp::thread_pool<dp::details::default_function_type>;
 
   constexpr std::string_view HEADER = "chrom\tpos\tend\tsvtype\tchrom\tpos\tend\tsvtype";
+  // header of the output shared by all mappers, lines start with the sv class of the mapper
+  constexpr std::string_view MERGED_HEADER
+      = "class\tchrom\tpos\tend\tsvtype\tchrom\tpos\tend\tsvtype";
+
+  /**
+   * @brief chromosomes of nl file to map, in the order of the header
+   *
+   * Every mapper writes one output section for each of them.
+   */
+  auto map_chroms(VcfPartitions const& nl_partitions) -> std::vector<std::string>;
 
   /**
    * @brief Detect mapping relationship for non-linear variation (NL) and SV (SV)
@@ -40,6 +51,8 @@ namespace sv2nl {
    * 3. Needed INFO fields: SVTYPE, SVEND
    * 4. Handle for every chromosome
    * 5. Write to one output file
+   *
+   * Both files are read once into partitions, which can be shared by all mappers.
    */
 
   struct mapper_options {
@@ -50,6 +63,13 @@ namespace sv2nl {
     std::string_view sv_type_;
     uint32_t diff_{0};
     bool use_strand_{true};
+    bool ordered_{true};
+    int threads_{0};
+    std::shared_ptr<const VcfPartitions> nl_partitions_{};
+    std::shared_ptr<const VcfPartitions> sv_partitions_{};
+    std::shared_ptr<Writer> writer_{};
+    std::string_view sv_class_;
+    std::size_t first_section_{0};
 
     mapper_options& nl_file(std::string_view file);
 
@@ -64,6 +84,34 @@ namespace sv2nl {
     mapper_options& diff(uint32_t num);
 
     mapper_options& use_strand(bool use);
+
+    /**
+     * @brief write results in the order of chromosomes in the header of the nl file, the
+     * output is the same in every run
+     */
+    mapper_options& ordered(bool use);
+
+    mapper_options& threads(int num);
+
+    mapper_options& nl_partitions(std::shared_ptr<const VcfPartitions> partitions);
+
+    mapper_options& sv_partitions(std::shared_ptr<const VcfPartitions> partitions);
+
+    /**
+     * @brief write into a writer shared with other mappers instead of output_file
+     */
+    mapper_options& writer(std::shared_ptr<Writer> shared_writer);
+
+    /**
+     * @brief first column of every output line, empty for no column
+     */
+    mapper_options& sv_class(std::string_view sv_class);
+
+    /**
+     * @brief index of the section of the first chromosome, sections of mappers sharing a writer
+     * must follow each other, see map_chroms
+     */
+    mapper_options& first_section(std::size_t index);
   };
 
   template <typename Derived> class Mapper {
@@ -73,37 +121,51 @@ namespace sv2nl {
     explicit Mapper(mapper_options const& opts)
         : nl_vcf_file_(opts.nl_file_),
           sv_vcf_file_(opts.sv_file_),
-          writer_(opts.output_file_, HEADER),
+          writer_(opts.writer_ != nullptr
+                      ? opts.writer_
+                      : std::make_shared<Writer>(opts.output_file_, HEADER, opts.threads_)),
           nl_type_(opts.nl_type_),
           sv_type_(opts.sv_type_),
           diff_(opts.diff_),
-          use_strand_(opts.use_strand_) {}
+          use_strand_(opts.use_strand_),
+          ordered_(opts.ordered_),
+          threads_(opts.threads_),
+          nl_partitions_(opts.nl_partitions_),
+          sv_partitions_(opts.sv_partitions_),
+          sv_class_(opts.sv_class_),
+          first_section_(opts.first_section_) {
+      load_partitions();
+    }
 
     Mapper(std::string_view non_linear_file, std::string_view sv_file, std::string_view output_file,
            std::string_view nl_type, std::string_view sv_type)
         : nl_vcf_file_(non_linear_file),
           sv_vcf_file_(sv_file),
-          writer_(output_file, HEADER),
+          writer_(std::make_shared<Writer>(output_file, HEADER)),
           nl_type_(nl_type),
-          sv_type_(sv_type) {}
+          sv_type_(sv_type) {
+      load_partitions();
+    }
 
     virtual ~Mapper() = default;
     Derived* derived() { return static_cast<Derived*>(this); }
     Derived const* derived() const { return static_cast<Derived const*>(this); }
 
-    void close_writer() const noexcept { writer_.close(); }
+    /**
+     * @throws VcfReaderError if the output could not be written or closed
+     */
+    void close_writer() const { writer_->close(); }
     [[maybe_unused]] bool use_strand() const noexcept { return use_strand_; }
 
     auto map(ThreadPool& pool) const -> void { return derived()->map_delegate(pool); }
 
     auto map_delegate(ThreadPool& pool) const -> void;
 
-    static auto build_tree(std::string_view chrom, const Sv2nlVcfRanges& vcf_ranges,
-                           std::string_view svtype) -> Sv2nlVcfIntervalTree;
-
-    [[maybe_unused]] static auto build_tree(std::initializer_list<std::string_view> chroms,
-                                            const Sv2nlVcfRanges& vcf_ranges,
-                                            std::string_view svtype) -> Sv2nlVcfIntervalTree;
+    /**
+     * @brief build interval tree from records of one partition
+     * @param records records of one chromosome and one svtype
+     */
+    static auto build_tree(VcfPartitions::records_type const& records) -> Sv2nlVcfIntervalTree;
 
     [[nodiscard]] bool find(std::string const&, std::vector<Sv2nlVcfRecord>&) const;
     [[nodiscard]] bool find(Sv2nlVcfRecord const&, std::vector<Sv2nlVcfRecord>&) const;
@@ -111,8 +173,34 @@ namespace sv2nl {
     void store(std::string const&, std::vector<Sv2nlVcfRecord>&) const;
     void store(Sv2nlVcfRecord const&, std::vector<Sv2nlVcfRecord>&) const;
 
+    /**
+     * @brief open vcf ranges which decompress with the threads of the mapper
+     * @param file vcf file path
+     * @param source source of the vcf file
+     */
+    auto open_ranges(fs::path const& file, std::string source) const -> Sv2nlVcfRanges;
+
   protected:
-    void map_impl(std::string_view chrom) const;
+    void map_impl(std::string_view chrom, Writer::Section& section) const;
+    void load_partitions();
+
+    /**
+     * @brief write nl records with the sv records of tree passing check_condition of Derived
+     *
+     * nl records of a partition are sorted by position, so they are joined against the tree in
+     * one sweep instead of one query from the root for each of them.
+     */
+    void map_records(VcfPartitions::records_type const& nl_records,
+                     Sv2nlVcfIntervalTree const& interval_tree, Writer::Section& section) const;
+
+    void write_overlaps(Sv2nlVcfRecord const& nl_vcf_record,
+                        std::vector<Sv2nlVcfRecord>& overlaps_vector,
+                        Writer::Section& section) const;
+
+    /**
+     * @brief output section of the index-th chromosome of map_chroms
+     */
+    auto output_section(std::size_t index) const -> Writer::Section;
 
     // Define pure virtual function
     // bool check_condition;
@@ -120,11 +208,17 @@ namespace sv2nl {
 
     fs::path nl_vcf_file_;
     fs::path sv_vcf_file_;
-    mutable Writer writer_;
+    std::shared_ptr<Writer> writer_;
     std::string nl_type_;
     std::string sv_type_;
     uint32_t diff_;
     bool use_strand_;
+    bool ordered_{true};
+    int threads_{0};
+    std::shared_ptr<const VcfPartitions> nl_partitions_{};
+    std::shared_ptr<const VcfPartitions> sv_partitions_{};
+    std::string sv_class_{};
+    std::size_t first_section_{0};
     mutable ThreadSafeMap<std::string, std::vector<Sv2nlVcfRecord>> cache_{};
   };
 
@@ -144,38 +238,28 @@ namespace sv2nl {
   }
 
   template <typename Derived>
-  auto Mapper<Derived>::build_tree(std::string_view chrom, const Sv2nlVcfRanges& vcf_ranges,
-                                   std::string_view svtype) -> Sv2nlVcfIntervalTree {
-    auto interval_tree = Sv2nlVcfIntervalTree{};
-
-    auto sorted_ = [](auto const& res) { return validate_record(res); };
-
-    auto chrom_view = vcf_ranges | std::views::filter([&chrom, &svtype](auto const& sv_vcf_record) {
-                        return sv_vcf_record.chrom == chrom && sv_vcf_record.info->svtype == svtype;
-                      })
-                      | std::views::transform(sorted_);
-
-    interval_tree.insert_node(chrom_view);
+  auto Mapper<Derived>::open_ranges(fs::path const& file, std::string source) const
+      -> Sv2nlVcfRanges {
+    auto vcf_ranges = Sv2nlVcfRanges(file.string(), std::move(source));
+    vcf_ranges.set_threads(threads_);
+    return vcf_ranges;
+  }
 
-    // no copy need to  move
-    return interval_tree;
+  template <typename Derived> void Mapper<Derived>::load_partitions() {
+    if (nl_partitions_ == nullptr) {
+      nl_partitions_ = VcfPartitions::load(open_ranges(nl_vcf_file_, "nls"));
+    }
+    if (sv_partitions_ == nullptr) {
+      sv_partitions_ = VcfPartitions::load(open_ranges(sv_vcf_file_, "delly"));
+    }
   }
 
   template <typename Derived>
-  [[maybe_unused]] auto Mapper<Derived>::build_tree(std::initializer_list<std::string_view> chroms,
-                                                    const Sv2nlVcfRanges& vcf_ranges,
-                                                    std::string_view svtype)
+  auto Mapper<Derived>::build_tree(VcfPartitions::records_type const& records)
       -> Sv2nlVcfIntervalTree {
-    auto interval_tree = Sv2nlVcfIntervalTree{};
-
-    auto chrom_view
-        = vcf_ranges | std::views::filter([&](auto const& sv_vcf_record) {
-            return std::ranges::any_of(chroms, [&](auto it) { return sv_vcf_record.chrom == it; })
-                   && (sv_vcf_record.info->svtype == svtype);
-          });
-    interval_tree.insert_node(chrom_view);
-
-    return interval_tree;
+    return Sv2nlVcfIntervalTree{records | std::views::transform([](auto const& record) {
+                                  return validate_record(record);
+                                })};
   }
 
   template <typename Derived> bool Mapper<Derived>::find(const Sv2nlVcfRecord& vcf_record,
@@ -191,57 +275,81 @@ namespace sv2nl {
     store(key, value);
   }
 
-  template <typename Derived> void Mapper<Derived>::map_impl(std::string_view chrom) const {
-    // avoid data trace cause now vcf ranges is not thread safe
-    auto nl_vcf_ranges = Sv2nlVcfRanges(nl_vcf_file_.string(), "nls");
-    auto sv_vcf_ranges = Sv2nlVcfRanges(sv_vcf_file_.string(), "delly");
+  template <typename Derived>
+  auto Mapper<Derived>::output_section(std::size_t index) const -> Writer::Section {
+    return writer_->section(ordered_ ? first_section_ + index : Writer::Section::UNORDERED,
+                            sv_class_);
+  }
 
-    auto interval_tree = build_tree(chrom, sv_vcf_ranges, sv_type_);
+  template <typename Derived>
+  void Mapper<Derived>::map_impl(std::string_view chrom, Writer::Section& section) const {
+    // partitions are read only and shared by all tasks
+    auto interval_tree = build_tree(sv_partitions_->get(chrom, sv_type_));
     spdlog::debug("{} interval tree size {}", chrom, interval_tree.size());
 
-    auto chrom_view
-        = nl_vcf_ranges | std::views::filter([&](auto const& nl_vcf_record) {
-            return nl_vcf_record.chrom == chrom && (nl_vcf_record.info->svtype == nl_type_);
-          });
-
-    for (auto nl_vcf_record : chrom_view) {
-      spdlog::debug("process nl record {} ", nl_vcf_record);
-      std::vector<Sv2nlVcfRecord> overlaps_vector{};
-
-      // check if the result of the record is  cached
-#ifdef SV2NL_USE_CACHE
-      if (!find(nl_vcf_record, overlaps_vector)) {
-#endif
-        overlaps_vector.push_back(nl_vcf_record);
-        auto validated_nl_vcf_record = validate_record(nl_vcf_record);
+    map_records(nl_partitions_->get(chrom, nl_type_), interval_tree, section);
+  }
 
-        auto&& res = interval_tree.find_overlaps(validated_nl_vcf_record);
-        auto res_view
-            = res | std::views::filter([&](auto const& vcf_interval) {
-                return derived()->check_condition(validated_nl_vcf_record, vcf_interval.record);
-              })
-              | std::views::transform([](auto const& vcf_interval) { return vcf_interval.record; });
+  template <typename Derived>
+  void Mapper<Derived>::map_records(VcfPartitions::records_type const& nl_records,
+                                    Sv2nlVcfIntervalTree const& interval_tree,
+                                    Writer::Section& section) const {
+    auto queries = std::vector<Sv2nlVcfInterval>{};
+    queries.reserve(nl_records.size());
+    std::ranges::transform(nl_records, std::back_inserter(queries), [](auto const& record) {
+      return Sv2nlVcfInterval{validate_record(record)};
+    });
+
+    // pairs of one nl record are visited together, it is written when the next one starts
+    std::vector<Sv2nlVcfRecord> overlaps_vector{};
+    auto current = nl_records.size();
+    auto write_current = [&] {
+      if (current < nl_records.size()) {
+        write_overlaps(nl_records[current], overlaps_vector, section);
+      }
+    };
+
+    interval_tree.sweep_overlaps(
+        queries, [&](std::size_t position, Sv2nlVcfInterval const& vcf_interval) {
+          // only records passing the condition are copied out of the tree
+          if (!derived()->check_condition(queries[position].record, vcf_interval.record)) return;
+          if (position != current) {
+            write_current();
+            current = position;
+            overlaps_vector.clear();
+            overlaps_vector.push_back(nl_records[position]);
+          }
+          overlaps_vector.push_back(vcf_interval.record);
+        });
+    write_current();
+  }
 
-        std::ranges::move(res_view, std::back_inserter(overlaps_vector));
+  template <typename Derived>
+  void Mapper<Derived>::write_overlaps(Sv2nlVcfRecord const& nl_vcf_record,
+                                       std::vector<Sv2nlVcfRecord>& overlaps_vector,
+                                       Writer::Section& section) const {
+    spdlog::debug("process nl record {} overlaps size: {}", nl_vcf_record, overlaps_vector.size());
 
 #ifdef SV2NL_USE_CACHE
-        if (overlaps_vector.size() > 1) {
-          store(nl_vcf_record, overlaps_vector);
-          // Do not output same nl key record
-          writer_.write(std::move(overlaps_vector));
-        }
-      }
+    // Do not output same nl key record
+    std::vector<Sv2nlVcfRecord> cached{};
+    if (find(nl_vcf_record, cached)) return;
+    store(nl_vcf_record, overlaps_vector);
 #endif
-    }
+    section.write(std::move(overlaps_vector));
   }
 
   template <typename Derived> auto Mapper<Derived>::map_delegate(ThreadPool& pool) const -> void {
-    auto&& nl_chroms = Sv2nlVcfRanges(nl_vcf_file_.string(), "nls").chroms();
-
-    for (auto chrom : nl_chroms | std::views::filter([](auto it) {
-                        return std::ranges::find(it, '_') == it.end();
-                      })) {
-      pool.enqueue_detach([&](std::string_view chrom_) { derived()->map_impl(chrom_); }, chrom);
+    auto chroms = map_chroms(*nl_partitions_);
+
+    for (std::size_t index = 0; index < chroms.size(); ++index) {
+      pool.enqueue_detach(
+          [this, index](std::string const& chrom_) {
+            auto section = output_section(index);
+            derived()->map_impl(chrom_, section);
+            writer_->commit(std::move(section));
+          },
+          chroms[index]);
     }
   }
 
@@ -281,8 +389,8 @@ namespace sv2nl {
   private:
     std::shared_ptr<Sv2nlVcfIntervalTree> build_sv_tree() const;
 
-    void map_impl(std::string_view chrom,
-                  const std::shared_ptr<Sv2nlVcfIntervalTree>& vcf_tree_ptr) const;
+    void map_impl(std::string_view chrom, const std::shared_ptr<Sv2nlVcfIntervalTree>& vcf_tree_ptr,
+                  Writer::Section& section) const;
     bool check_condition(Sv2nlVcfRecord const& nl_vcf_record,
                          Sv2nlVcfRecord const& sv_vcf_record) const;
   };
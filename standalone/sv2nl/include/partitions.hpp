@@ -0,0 +1,72 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#ifndef BUILDALL_STANDALONE_SV2NL_INCLUDE_PARTITIONS_HPP_
+#define BUILDALL_STANDALONE_SV2NL_INCLUDE_PARTITIONS_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vcf_info.hpp"
+
+namespace sv2nl {
+
+  /**
+   * @brief Records of one vcf file bucketed by chromosome and svtype
+   *
+   * The file is read exactly once, all mappers share the partitions read-only.
+   */
+  class VcfPartitions {
+  public:
+    using records_type = std::vector<Sv2nlVcfRecord>;
+
+    VcfPartitions() = default;
+
+    /**
+     * @brief read all records of the vcf file in a single pass
+     * @param vcf_ranges vcf file to read
+     * @return partitions shared by mappers
+     */
+    static auto load(Sv2nlVcfRanges const& vcf_ranges) -> std::shared_ptr<const VcfPartitions>;
+
+    /**
+     * @brief get records of one chromosome and one svtype in file order
+     * @return empty records if not found
+     */
+    [[nodiscard]] auto get(std::string_view chrom, std::string_view svtype) const
+        -> records_type const&;
+
+    /**
+     * @brief get records of one svtype of all chromosomes, in the order of chroms
+     *
+     * Records are gathered on the first call for the svtype and shared by later calls.
+     */
+    [[nodiscard]] auto get(std::string_view svtype) const -> records_type const&;
+
+    /**
+     * @brief contigs in the order of the vcf header
+     */
+    [[nodiscard]] auto chroms() const -> std::vector<std::string> const&;
+
+    [[nodiscard]] auto size() const -> std::size_t;
+
+  private:
+    std::vector<std::string> chroms_{};
+    std::map<vcf::Contig, std::map<std::string, records_type, std::less<>>, std::less<>>
+        partitions_{};
+    std::size_t size_{};
+
+    mutable std::mutex svtypes_mutex_{};
+    // records of all chromosomes by svtype, nodes are never erased so references stay valid
+    mutable std::map<std::string, records_type, std::less<>> svtypes_{};
+  };
+
+}  // namespace sv2nl
+
+#endif  // BUILDALL_STANDALONE_SV2NL_INCLUDE_PARTITIONS_HPP_
@@ -5,7 +5,9 @@
 #ifndef BUILDALL_STANDALONE_SV2NL_INFO_FILED_HPP_
 #define BUILDALL_STANDALONE_SV2NL_INFO_FILED_HPP_
 #include <binary/algorithm/interval_tree.hpp>
+#include <binary/algorithm/static_interval_index.hpp>
 #include <binary/parser/vcf.hpp>
+#include <type_traits>
 
 namespace sv2nl {
   namespace tree = binary::algorithm::tree;
@@ -15,7 +17,7 @@ namespace sv2nl {
     std::string svtype{};
     vcf::pos_t svend{};
 
-    std::string chr2{};
+    vcf::Contig chr2{};
     bool strand1{true};  // true means positive
     bool strand2{true};
 
@@ -29,6 +31,11 @@ namespace sv2nl {
     void update(const std::shared_ptr<vcf::details::DataImpl>& data,
                 std::string_view source_) override;
 
+    /**
+     * @brief decode the INFO column of a text vcf line, records of plain vcf use it
+     */
+    void update(std::string_view info, std::string_view source_);
+
     friend auto operator<<(std::ostream& os, Sv2nlInfoField const& info) -> std::ostream& {
       os << "svtype: " << info.svtype << " svend: " << info.svend;
       return os;
@@ -37,13 +44,25 @@ namespace sv2nl {
     friend auto operator==(Sv2nlInfoField const& lhs, Sv2nlInfoField const& rhs) -> bool {
       return lhs.svtype == rhs.svtype && lhs.svend == rhs.svend;
     }
+
+  private:
+    // index of keys, ids are resolved once for every opened file
+    enum Key : std::size_t { Svtype, Chr2, Strand1, Strand2, Pos2, Svend, End, Size };
+    static constexpr std::array<std::string_view, Key::Size> keys_{
+        "SVTYPE", "CHR2", "STRAND1", "STRAND2", "POS2", "SVEND", "END"};
+
+    // get(std::type_identity<DataType>, key) returns the value of key in the current record
+    template <typename Getter> void decode(Getter const& get, std::string_view source);
+
+    vcf::details::InfoKeyIds<Key::Size> key_ids_{};
   };
 
   using Sv2nlVcfRecord = vcf::BaseVcfRecord<Sv2nlInfoField>;
   using Sv2nlVcfRanges = vcf::VcfRanges<Sv2nlVcfRecord>;
   using Sv2nlVcfInterval = vcf::BaseVcfInterval<Sv2nlVcfRecord>;
   using Sv2nlVcfIntervalNode = tree::IntervalNode<Sv2nlVcfInterval>;
-  using Sv2nlVcfIntervalTree = tree::IntervalTree<Sv2nlVcfIntervalNode>;
+  // trees are built once before mapping and only queried afterwards
+  using Sv2nlVcfIntervalTree = tree::StaticIntervalIndex<Sv2nlVcfInterval>;
 
 }  // namespace sv2nl
 #endif  // BUILDALL_STANDALONE_SV2NL_INFO_FILED_HPP_
@@ -4,69 +4,192 @@
 
 #ifndef BUILDALL_STANDALONE_SV2NL_WRITER_HPP_
 #define BUILDALL_STANDALONE_SV2NL_WRITER_HPP_
+#include <htslib/bgzf.h>
+#include <htslib/thread_pool.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <ranges>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include "vcf_info.hpp"
 
 namespace sv2nl {
 
+  /**
+   * @brief tsv writer shared by threads
+   *
+   * Every thread formats lines into its own buffer, a lock is only taken when a thread writes
+   * to another writer than the last one. Full buffers are handed to one writer thread, which
+   * is the only one touching the file. Lines of one write call stay together, lines of
+   * different threads are interleaved in blocks. Lines written to sections are written in the
+   * order of sections instead, see Section.
+   *
+   * Files ending with .gz or .bgz are written as bgzf, which can be indexed by tabix once
+   * sorted. Blocks are compressed by the htslib thread pool in the background.
+   */
   class Writer {
   public:
-    explicit Writer(std::string_view filename) : filename_(filename), ofs_(filename_) {
-      write_header();
+    // size of a thread buffer which is handed to the writer thread
+    static constexpr std::size_t FLUSH_SIZE = 1 << 20;
+    // number of blocks waiting for the writer thread before threads block
+    static constexpr std::size_t MAX_PENDING_BLOCKS = 16;
+
+    explicit Writer(std::string_view filename, int num_threads = 0) : filename_(filename) {
+      open(num_threads);
     }
 
-    Writer(std::string_view filename, std::string_view header)
-        : filename_(filename), ofs_(filename_), header_(header) {
-      write_header();
+    Writer(std::string_view filename, std::string_view header, int num_threads = 0)
+        : filename_(filename), header_(header) {
+      open(num_threads);
+    }
+
+    Writer(Writer const&) = delete;
+    Writer& operator=(Writer const&) = delete;
+    ~Writer();
+
+    /**
+     * @brief lines of one task, e.g. one chromosome, written in the order of section indexes
+     *
+     * Sections are written after all sections with smaller indexes are committed, the section
+     * with the smallest uncommitted index is streamed to the file while it grows. Every index
+     * from 0 must be committed once, sections left uncommitted are written by close.
+     */
+    class Section {
+    public:
+      // section written when committed, regardless of other sections
+      static constexpr std::size_t UNORDERED = std::numeric_limits<std::size_t>::max();
+
+      Section(Section&&) noexcept = default;
+      Section& operator=(Section&&) noexcept = default;
+      ~Section() = default;
+
+      template <std::ranges::input_range Sv2nlRecordRange>
+      requires std::same_as<std::ranges::range_value_t<Sv2nlRecordRange>, Sv2nlVcfRecord>
+      void write(Sv2nlRecordRange&& records) {
+        if (records.size() < 2) return;
+        append_lines(buffer_, records, prefix_);
+        if (buffer_.size() >= FLUSH_SIZE) writer_->flush(*this);
+      }
+
+      [[nodiscard]] auto index() const noexcept -> std::size_t { return index_; }
+
+    private:
+      friend class Writer;
+      Section(Writer* writer, std::size_t index, std::string prefix)
+          : writer_{writer}, index_{index}, prefix_{std::move(prefix)} {}
+
+      Writer* writer_{nullptr};
+      std::size_t index_{UNORDERED};
+      std::string prefix_{};
+      fmt::memory_buffer buffer_{};
+    };
+
+    /**
+     * @param column first column of every line of the section, e.g. the sv class of lines
+     * in a merged output, no column is added if it is empty
+     */
+    [[nodiscard]] auto section(std::size_t index, std::string_view column = "") -> Section {
+      return Section{this, index, column.empty() ? std::string{} : fmt::format("{}\t", column)};
     }
 
+    /**
+     * @brief write lines of section once all sections before it are committed
+     */
+    void commit(Section section);
+
     template <std::ranges::input_range Sv2nlRecordRange>
     requires std::same_as<std::ranges::range_value_t<Sv2nlRecordRange>, Sv2nlVcfRecord>
     void write(Sv2nlRecordRange&& records) {
       if (records.size() < 2) return;
-      auto key_line = format_keys(records[0]);
-
-      std::lock_guard lock{mutex_};
-      for (auto&& record :
-           std::ranges::subrange(std::ranges::begin(records) + 1, std::ranges::end(records))) {
-        spdlog::debug("write record {}", record);
-        ofs_ << key_line << '\t' << format_keys(record) << '\n';
-      }
+      format_lines(records);
     }
 
     template <std::ranges::input_range Sv2nlRecordRange>
     requires std::same_as<std::ranges::range_value_t<Sv2nlRecordRange>, Sv2nlVcfRecord>
     void write_trans(Sv2nlRecordRange&& records) {
       if (records.size() < 2) return;
-      auto key_line = format_keys(records[0]);
+      format_lines(records);
+    }
+
+    void write(std::string_view line);
+
+    /**
+     * @brief write buffers of all threads and close the file, threads must not write anymore
+     */
+    void close();
+
+    static std::string format_keys(Sv2nlVcfRecord const& record);
+    static void format_keys(fmt::memory_buffer& buffer, Sv2nlVcfRecord const& record);
+
+    [[nodiscard]] static auto is_bgzf_path(std::string_view filename) -> bool;
+
+  private:
+    template <typename Sv2nlRecordRange> void format_lines(Sv2nlRecordRange&& records) {
+      auto& buffer = local_buffer();
+      append_lines(buffer, records);
+      if (buffer.size() >= FLUSH_SIZE) submit(buffer);
+    }
+
+    template <typename Sv2nlRecordRange>
+    static void append_lines(fmt::memory_buffer& buffer, Sv2nlRecordRange&& records,
+                             std::string_view prefix = "") {
+      auto key_line = fmt::memory_buffer{};
+      key_line.append(prefix.data(), prefix.data() + prefix.size());
+      format_keys(key_line, records[0]);
 
-      std::lock_guard lock{mutex_};
       for (auto&& record :
            std::ranges::subrange(std::ranges::begin(records) + 1, std::ranges::end(records))) {
         spdlog::debug("write record {}", record);
-        ofs_ << key_line << '\t' << format_keys(record) << '\n';
+        buffer.append(key_line.data(), key_line.data() + key_line.size());
+        buffer.push_back('\t');
+        format_keys(buffer, record);
+        buffer.push_back('\n');
       }
     }
 
-    void write(std::string const& line);
-    void close() {
-      std::lock_guard lock{mutex_};
-      ofs_.close();
-    }
-
-    static std::string format_keys(Sv2nlVcfRecord const& record);
+    void open(int num_threads);
+    auto local_buffer() -> fmt::memory_buffer&;
+    void flush(Section& section);
+    void submit(fmt::memory_buffer& buffer);
+    void submit(std::string block);
+    void run_writer();
+    void write_text(std::string_view text);
 
-  private:
-    void write_header();
+    struct BgzfCloser {
+      void operator()(BGZF* fp) const noexcept { bgzf_close(fp); }
+    };
 
     std::string filename_{};
-    mutable std::ofstream ofs_{};
+    std::ofstream ofs_{};
+    std::shared_ptr<hts_tpool> thread_pool_{nullptr};  // outlives bgzf_
+    std::unique_ptr<BGZF, BgzfCloser> bgzf_{nullptr};
     std::string header_{};
-    mutable std::mutex mutex_{};
+    std::uint64_t id_{0};  // identify this writer in the buffer cache of every thread
+
+    std::mutex buffers_mutex_{};  // only taken when a thread switches to this writer
+    // released by close, threads only keep a pointer to the buffer of their last writer
+    std::unordered_map<std::thread::id, std::unique_ptr<fmt::memory_buffer>> buffers_{};
+
+    std::mutex sections_mutex_{};
+    std::size_t next_section_{0};
+    std::map<std::size_t, std::string> pending_sections_{};
+
+    std::mutex queue_mutex_{};
+    std::condition_variable queue_changed_{};
+    std::deque<std::string> queue_{};
+    bool closing_{false};
+    std::exception_ptr error_{nullptr};
+    std::thread writer_thread_{};
   };
 
 }  // namespace sv2nl
@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <binary/utils.hpp>
 #include <cxxopts.hpp>
+#include <exception>
+#include <future>
 #include <iostream>
 #include <string>
 
@@ -27,8 +29,15 @@
 
 constexpr int NUM_THREADS = 4;
 
+// outputs of output.tsv.gz are output.tsv.dup.gz and so on, which are compressed as well
 inline std::vector<std::string> creat_files_name(std::string_view output) {
-  return {std::string(output) + ".dup", std::string(output) + ".inv", std::string(output) + ".tra"};
+  auto suffix = std::string_view{};
+  if (sv2nl::Writer::is_bgzf_path(output)) {
+    suffix = output.substr(output.rfind('.'));
+    output.remove_suffix(suffix.size());
+  }
+  return {fmt::format("{}.dup{}", output, suffix), fmt::format("{}.inv{}", output, suffix),
+          fmt::format("{}.tra{}", output, suffix)};
 }
 
 void submit_task(sv2nl::DupMapper const& dup, sv2nl::InvMapper const& inv,
@@ -44,35 +53,52 @@ void submit_task(sv2nl::DupMapper const& dup, sv2nl::InvMapper const& inv,
 }
 
 void run(std::string_view nl_, std::string_view sv_, std::string_view output_, uint32_t diff_,
-         int num_threads, bool use_strand) {
-  auto files = creat_files_name(output_);
-
-  auto nl_vcf = sv2nl::Sv2nlVcfRanges{std::string(nl_), "nls"};
-
-  auto dup_mapper = sv2nl::DupMapper(sv2nl::mapper_options()
-                                         .nl_file(nl_)
-                                         .sv_file(sv_)
-                                         .output_file(*files.begin())
-                                         .nl_type("TDUP")
-                                         .sv_type("DUP")
-                                         .diff(diff_));
-
-  auto inv_mapper = sv2nl::InvMapper(sv2nl::mapper_options()
-                                         .nl_file(nl_)
-                                         .sv_file(sv_)
-                                         .output_file(*(files.begin() + 1))
-                                         .nl_type("INV")
-                                         .sv_type("INV")
-                                         .diff(diff_)
-                                         .use_strand(use_strand));
-
-  auto tra_mapper = sv2nl::TraMapper(sv2nl::mapper_options()
-                                         .nl_file(nl_)
-                                         .sv_file(sv_)
-                                         .output_file(*(files.begin() + 2))
-                                         .nl_type("TRA")
-                                         .sv_type("BND")
-                                         .diff(diff_));
+         int num_threads, bool use_strand, bool ordered, bool is_merged) {
+  // read every input file only once and share partitions among mappers
+  auto load = [num_threads](std::string_view file, std::string source) {
+    auto vcf_ranges = sv2nl::Sv2nlVcfRanges{std::string(file), std::move(source)};
+    vcf_ranges.set_threads(num_threads);
+    return sv2nl::VcfPartitions::load(vcf_ranges);
+  };
+
+  auto nl_future = std::async(std::launch::async, load, nl_, "nls");
+  auto sv_partitions = load(sv_, "delly");
+  auto nl_partitions = nl_future.get();
+
+  // merged output is written by all mappers at once, the sections of dup come first, then inv
+  // and tra, which is the order of the separate outputs
+  auto merged_writer = std::shared_ptr<sv2nl::Writer>{};
+  auto num_sections = std::size_t{0};
+  auto files = std::vector<std::string>{};
+  if (is_merged) {
+    merged_writer = std::make_shared<sv2nl::Writer>(output_, sv2nl::MERGED_HEADER, num_threads);
+    num_sections = sv2nl::map_chroms(*nl_partitions).size();
+  } else {
+    files = creat_files_name(output_);
+  }
+
+  // index is the position of the mapper in the output, dup, inv and then tra
+  auto options = [&](std::size_t index, std::string_view sv_class) {
+    auto opts = sv2nl::mapper_options()
+                    .nl_file(nl_)
+                    .sv_file(sv_)
+                    .diff(diff_)
+                    .ordered(ordered)
+                    .threads(num_threads)
+                    .nl_partitions(nl_partitions)
+                    .sv_partitions(sv_partitions);
+    if (is_merged) {
+      opts.writer(merged_writer).sv_class(sv_class).first_section(index * num_sections);
+    } else {
+      opts.output_file(files[index]);
+    }
+    return opts;
+  };
+
+  auto dup_mapper = sv2nl::DupMapper(options(0, "dup").nl_type("TDUP").sv_type("DUP"));
+  auto inv_mapper = sv2nl::InvMapper(
+      options(1, "inv").nl_type("INV").sv_type("INV").use_strand(use_strand));
+  auto tra_mapper = sv2nl::TraMapper(options(2, "tra").nl_type("TRA").sv_type("BND"));
 
   submit_task(dup_mapper, inv_mapper, tra_mapper, num_threads);
   tra_mapper.close_writer();
@@ -89,10 +115,11 @@ int main(int argc, char* argv[]) {
   ("sv", "The file path of segment information from delly", cxxopts::value<std::string>())
   ("non-linear", "The file path of non-linear information from scannls", cxxopts::value<std::string>())
   ("dis", "The distance threshold for trans mapper", cxxopts::value<uint32_t>()->default_value("1000000"))
-  ("o,output", "The file path of output", cxxopts::value<std::string>()->default_value("output.tsv"))
-  ("t,thread", "The number of thread program use", cxxopts::value<int32_t>()->default_value(std::to_string(NUM_THREADS)))
+  ("o,output", "The file path of output, compressed with bgzf if it ends with .gz", cxxopts::value<std::string>()->default_value("output.tsv"))
+  ("t,thread", "The number of thread program use, also used for decompression", cxxopts::value<int32_t>()->default_value(std::to_string(NUM_THREADS)))
   ("s,short", "If running in short read and do not use strand", cxxopts::value<bool>()->default_value("false"))
-  ("m,merge", "If provided only merge outputs into one file", cxxopts::value<bool>()->default_value("false"))
+  ("u,unordered", "Write results as soon as they are found, the order of lines may change between runs", cxxopts::value<bool>()->default_value("false"))
+  ("m,merge", "Write all results into one file with the sv class in the first column", cxxopts::value<bool>()->default_value("false"))
   ("d,debug", "Print debug info", cxxopts::value<bool>()->default_value("false"))
   ("h,help", "Print help")
   ("v,version", "Print the current version number");
@@ -124,6 +151,7 @@ int main(int argc, char* argv[]) {
     auto is_merged = result["merge"].as<bool>();
     auto num_threads = result["thread"].as<int32_t>();
     auto use_strand = !result["short"].as<bool>();
+    auto ordered = !result["unordered"].as<bool>();
 
     if (!binary::utils::check_file_path({segment_path, nonlinear_path})) {
       std::exit(1);
@@ -141,24 +169,27 @@ int main(int argc, char* argv[]) {
     spdlog::info("distance threshold: {} bp", diff);
     spdlog::info("the number of threads: {}", num_threads);
     spdlog::info("use strand: {} ", use_strand);
+    spdlog::info("ordered output: {} ", ordered);
 
     Timer timer{};
-    run(nonlinear_path, segment_path, output_path, diff, num_threads, use_strand);
-
-    if (is_merged) {
-      binary::utils::merge_files(creat_files_name(output_path), output_path, sv2nl::HEADER);
-    }
+    run(nonlinear_path, segment_path, output_path, diff, num_threads, use_strand, ordered,
+        is_merged);
 
     spdlog::info("elapsed time: {:.2f}s", timer.elapsed());
-    if (is_merged)
+    if (is_merged) {
       spdlog::info("result file path: {}", output_path);
-    else
-      spdlog::info("result file path: {}[.dup|.inv|.tra]", output_path);
+    } else {
+      auto files = creat_files_name(output_path);
+      spdlog::info("result file path: {} {} {}", files[0], files[1], files[2]);
+    }
 
   } catch (const cxxopts::option_has_no_value_exception& err) {
     spdlog::error("error parsing options: {} ", err.what());
     std::cout << options.help() << "\n";
     std::exit(1);
+  } catch (const std::exception& err) {
+    spdlog::error("{}", err.what());
+    return 1;
   }
 
   return 0;
@@ -47,6 +47,49 @@ namespace sv2nl {
     return *this;
   }
 
+  mapper_options& mapper_options::ordered(bool use) {
+    ordered_ = use;
+    return *this;
+  }
+
+  mapper_options& mapper_options::threads(int num) {
+    threads_ = num;
+    return *this;
+  }
+
+  mapper_options& mapper_options::nl_partitions(std::shared_ptr<const VcfPartitions> partitions) {
+    nl_partitions_ = std::move(partitions);
+    return *this;
+  }
+
+  mapper_options& mapper_options::sv_partitions(std::shared_ptr<const VcfPartitions> partitions) {
+    sv_partitions_ = std::move(partitions);
+    return *this;
+  }
+
+  mapper_options& mapper_options::writer(std::shared_ptr<Writer> shared_writer) {
+    writer_ = std::move(shared_writer);
+    return *this;
+  }
+
+  mapper_options& mapper_options::sv_class(std::string_view sv_class) {
+    sv_class_ = sv_class;
+    return *this;
+  }
+
+  mapper_options& mapper_options::first_section(std::size_t index) {
+    first_section_ = index;
+    return *this;
+  }
+
+  auto map_chroms(VcfPartitions const& nl_partitions) -> std::vector<std::string> {
+    auto chroms = std::vector<std::string>{};
+    std::ranges::copy_if(nl_partitions.chroms(), std::back_inserter(chroms), [](auto const& chrom) {
+      return std::ranges::find(chrom, '_') == chrom.end();
+    });
+    return chroms;
+  }
+
   bool DupMapper::check_condition(const Sv2nlVcfRecord& nl_vcf_record,
                                   const Sv2nlVcfRecord& sv_vcf_record) const {
     spdlog::debug("check condition with {}", sv_vcf_record);
@@ -79,65 +122,26 @@ namespace sv2nl {
   }
 
   void TraMapper::map_impl(std::string_view chrom,
-                           const std::shared_ptr<Sv2nlVcfIntervalTree>& vcf_tree_ptr) const {
-    // avoid data trace cause now vcf ranges is not thread safe
+                           const std::shared_ptr<Sv2nlVcfIntervalTree>& vcf_tree_ptr,
+                           Writer::Section& section) const {
     spdlog::debug("[tra] chrom {} interval tree size: {}", chrom, vcf_tree_ptr->size());
 
-    auto nl_vcf_ranges = Sv2nlVcfRanges(nl_vcf_file_.string(), "nls");
-
-    auto nl_chrom_view
-        = nl_vcf_ranges | std::views::filter([&](auto const& nl_vcf_record) {
-            return nl_vcf_record.chrom == chrom && nl_vcf_record.info->svtype == nl_type_;
-          });
-
-    for (auto nl_vcf_record : nl_chrom_view) {
-      spdlog::debug("[tra] process nl vcf {}", nl_vcf_record);
-      std::vector<Sv2nlVcfRecord> overlaps_vector{};
-
-      // check if the result of the record is  cached
-#ifdef SV2NL_USE_CACHE
-      if (!find(nl_vcf_record, overlaps_vector)) {
-#endif
-        overlaps_vector.push_back(nl_vcf_record);
-        auto validated_nl_vcf_record = validate_record(nl_vcf_record);
-
-        auto&& res = vcf_tree_ptr->find_overlaps(validated_nl_vcf_record);
-
-        auto res_view
-            = res | std::views::filter([&](auto const& vcf_interval) {
-                return check_condition(validated_nl_vcf_record, vcf_interval.record);
-              })
-              | std::views::transform([](auto const& vcf_interval) { return vcf_interval.record; });
-
-        std::ranges::move(res_view, std::back_inserter(overlaps_vector));
-
-        spdlog::trace("[tra] overlaps size: {}", overlaps_vector.size());
-
-#ifdef SV2NL_USE_CACHE
-        if (overlaps_vector.size() > 1) {
-          store(nl_vcf_record, overlaps_vector);
-          // Do not output same nl key record
-          writer_.write_trans(std::move(overlaps_vector));
-        }
-      }
-#endif
-    }
+    map_records(nl_partitions_->get(chrom, nl_type_), *vcf_tree_ptr, section);
   }
 
   auto TraMapper::map_delegate(ThreadPool& pool) const -> void {
-    auto&& nl_chroms = Sv2nlVcfRanges(nl_vcf_file_.string(), "nls").chroms();
-
+    auto chroms = map_chroms(*nl_partitions_);
     auto sv_tree_pointer = build_sv_tree();
 
-    for (auto chrom : nl_chroms | std::views::filter([](auto it) {
-                        return std::ranges::find(it, '_') == it.end();
-                      })) {
-      spdlog::debug("[tra] chrom {} is processing ", chrom);
+    for (std::size_t index = 0; index < chroms.size(); ++index) {
+      spdlog::debug("[tra] chrom {} is processing ", chroms[index]);
       pool.enqueue_detach(
-          [&](std::string_view chrom_, std::shared_ptr<Sv2nlVcfIntervalTree> tree) {
-            map_impl(chrom_, tree);
+          [this, index](std::string const& chrom_, std::shared_ptr<Sv2nlVcfIntervalTree> tree) {
+            auto section = output_section(index);
+            map_impl(chrom_, tree, section);
+            writer_->commit(std::move(section));
           },
-          chrom, sv_tree_pointer);
+          chroms[index], sv_tree_pointer);
     }
   }
 
@@ -156,17 +160,8 @@ namespace sv2nl {
   }
 
   std::shared_ptr<Sv2nlVcfIntervalTree> TraMapper::build_sv_tree() const {
-    auto sv_vcf_ranges = Sv2nlVcfRanges(sv_vcf_file_.string(), "delly");
-
-    auto sv_trans_view = sv_vcf_ranges | std::views::filter([&](auto const sv_vcf_record) {
-                           return sv_vcf_record.info->svtype == sv_type_;
-                         });
-
-    auto sv_interval_tree = std::make_shared<Sv2nlVcfIntervalTree>();
-
-    sv_interval_tree->insert_node(sv_trans_view);
-
-    return sv_interval_tree;
+    // translocations of all chromosomes, gathered once by the shared partitions
+    return std::make_shared<Sv2nlVcfIntervalTree>(sv_partitions_->get(sv_type_));
   }
 
 }  // namespace sv2nl
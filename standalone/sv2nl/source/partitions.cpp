@@ -0,0 +1,57 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include "partitions.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace sv2nl {
+
+  auto VcfPartitions::load(Sv2nlVcfRanges const& vcf_ranges)
+      -> std::shared_ptr<const VcfPartitions> {
+    auto partitions = std::make_shared<VcfPartitions>();
+    partitions->chroms_ = vcf_ranges.chroms();
+
+    for (auto const& record : vcf_ranges) {
+      partitions->partitions_[record.chrom][record.info->svtype].push_back(record);
+      ++partitions->size_;
+    }
+
+    spdlog::debug("[partitions] load {} records from {}", partitions->size_,
+                  vcf_ranges.file_path());
+    return partitions;
+  }
+
+  auto VcfPartitions::get(std::string_view chrom, std::string_view svtype) const
+      -> records_type const& {
+    static const records_type empty{};
+
+    if (auto chrom_iter = partitions_.find(chrom); chrom_iter != partitions_.end()) {
+      if (auto iter = chrom_iter->second.find(svtype); iter != chrom_iter->second.end()) {
+        return iter->second;
+      }
+    }
+    return empty;
+  }
+
+  auto VcfPartitions::get(std::string_view svtype) const -> records_type const& {
+    std::lock_guard lock{svtypes_mutex_};
+    if (auto iter = svtypes_.find(svtype); iter != svtypes_.end()) return iter->second;
+
+    auto records = records_type{};
+    for (auto const& chrom : chroms_) {
+      std::ranges::copy(get(chrom, svtype), std::back_inserter(records));
+    }
+    return svtypes_.emplace(svtype, std::move(records)).first->second;
+  }
+
+  auto VcfPartitions::chroms() const -> std::vector<std::string> const& { return chroms_; }
+
+  auto VcfPartitions::size() const -> std::size_t { return size_; }
+
+}  // namespace sv2nl
@@ -6,40 +6,54 @@
 
 namespace sv2nl {
 
-  void Sv2nlInfoField::update(const std::shared_ptr<vcf::details::DataImpl>& data,
-                              std::string_view source) {
-    svtype = vcf::get_info_field<char>("SVTYPE", data->header.get(), data->record.get());
+  template <typename Getter>
+  void Sv2nlInfoField::decode(Getter const& get, std::string_view source) {
+    using std::type_identity;
+    svtype = get(type_identity<char>{}, Svtype);
 
     if (svtype == "TRA" || svtype == "BND") {
-      chr2 = vcf::get_info_field<char>("CHR2", data->header.get(), data->record.get());
+      chr2 = vcf::Contig{get(type_identity<char>{}, Chr2)};
     }
 
     if (svtype == "INV") {
       // fetch strand info for inversion in non-linear result
       try {
-        strand1
-            = vcf::get_info_field<char>("STRAND1", data->header.get(), data->record.get()) == "+"
-                  ? true
-                  : false;
-
-        strand2
-            = vcf::get_info_field<char>("STRAND2", data->header.get(), data->record.get()) == "+"
-                  ? true
-                  : false;
+        strand1 = get(type_identity<char>{}, Strand1) == "+" ? true : false;
+
+        strand2 = get(type_identity<char>{}, Strand2) == "+" ? true : false;
       } catch (...) {
       }
     }
 
     if (svtype == "BND") {
       // delly tra result
-      svend = vcf::get_info_field<vcf::pos_t>("POS2", data->header.get(), data->record.get());
+      svend = get(type_identity<vcf::pos_t>{}, Pos2);
     } else if (source == "nls") {
       // nls result
-      svend = vcf::get_info_field<vcf::pos_t>("SVEND", data->header.get(), data->record.get());
+      svend = get(type_identity<vcf::pos_t>{}, Svend);
     } else {
       // delly other results
-      svend = vcf::get_info_field<vcf::pos_t>("END", data->header.get(), data->record.get());
+      svend = get(type_identity<vcf::pos_t>{}, End);
     }
   }
 
+  void Sv2nlInfoField::update(const std::shared_ptr<vcf::details::DataImpl>& data,
+                              std::string_view source) {
+    auto const& ids = key_ids_.resolve(*data, keys_);
+    decode(
+        [&]<typename DataType>(std::type_identity<DataType>, Key key) {
+          return data->template info<DataType>(ids[key], keys_[key]);
+        },
+        source);
+  }
+
+  void Sv2nlInfoField::update(std::string_view info, std::string_view source) {
+    decode(
+        [info]<typename DataType>(std::type_identity<DataType>, Key key) {
+          return vcf::details::parse_text_info_value<DataType>(
+              vcf::VcfTextReader::find_info(info, keys_[key]), keys_[key]);
+        },
+        source);
+  }
+
 }  // namespace sv2nl
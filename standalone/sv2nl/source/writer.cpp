@@ -6,24 +6,210 @@
 
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <iterator>
+#include <utility>
+
 namespace sv2nl {
 
-  void Writer::write_header() {
-    if (header_.empty()) return;
-    std::lock_guard lock{mutex_};
-    ofs_ << header_ << '\n';
+  namespace {
+    auto next_writer_id() -> std::uint64_t {
+      static std::atomic<std::uint64_t> id{0};
+      return ++id;
+    }
+  }  // namespace
+
+  Writer::~Writer() {
+    try {
+      close();
+    } catch (std::exception const& err) {
+      spdlog::error("{}", err.what());
+    }
+  }
+
+  auto Writer::is_bgzf_path(std::string_view filename) -> bool {
+    return filename.ends_with(".gz") || filename.ends_with(".bgz");
+  }
+
+  void Writer::open(int num_threads) {
+    if (!is_bgzf_path(filename_)) {
+      ofs_.open(filename_);
+      if (!ofs_) throw binary::VcfReaderError("Failed to open " + filename_);
+    } else {
+      bgzf_.reset(bgzf_open(filename_.c_str(), "w"));
+      if (bgzf_ == nullptr) throw binary::VcfReaderError("Failed to open " + filename_);
+
+      // the queue of blocks waiting for compression is bounded by htslib
+      thread_pool_ = binary::parser::vcf::details::shared_thread_pool(num_threads);
+      if (thread_pool_ && bgzf_thread_pool(bgzf_.get(), thread_pool_.get(), 0) < 0) {
+        throw binary::VcfReaderError("Failed to set thread pool of " + filename_);
+      }
+    }
+
+    if (!header_.empty()) write_text(header_ + '\n');
+    id_ = next_writer_id();
+    writer_thread_ = std::thread([this] { run_writer(); });
+  }
+
+  auto Writer::local_buffer() -> fmt::memory_buffer& {
+    // buffer of the last writer of this thread, ids are never reused so a closed writer never
+    // matches and nothing is kept per writer in the thread
+    thread_local std::uint64_t cached_id{0};
+    thread_local fmt::memory_buffer* cached_buffer{nullptr};
+    if (cached_id == id_) return *cached_buffer;
+
+    std::lock_guard lock{buffers_mutex_};
+    auto& buffer = buffers_[std::this_thread::get_id()];
+    if (buffer == nullptr) buffer = std::make_unique<fmt::memory_buffer>();
+    cached_id = id_;
+    cached_buffer = buffer.get();
+    return *buffer;
   }
-  void Writer::write(const std::string& line) {
-    std::lock_guard lock{mutex_};
-    ofs_ << line << '\n';
+
+  void Writer::flush(Section& section) {
+    if (section.index_ == Section::UNORDERED) {
+      submit(section.buffer_);
+      return;
+    }
+
+    // only the leading section can be written before it is committed
+    std::lock_guard lock{sections_mutex_};
+    if (section.index_ == next_section_) submit(section.buffer_);
+  }
+
+  void Writer::commit(Section section) {
+    if (section.index_ == Section::UNORDERED) {
+      if (section.buffer_.size() > 0) submit(section.buffer_);
+      return;
+    }
+
+    std::lock_guard lock{sections_mutex_};
+    if (section.index_ < next_section_ || pending_sections_.contains(section.index_)) {
+      throw binary::VcfReaderError("Section " + std::to_string(section.index_)
+                                   + " is committed twice to " + filename_);
+    }
+    pending_sections_.emplace(section.index_, fmt::to_string(section.buffer_));
+
+    for (auto iter = pending_sections_.begin();
+         iter != pending_sections_.end() && iter->first == next_section_;
+         iter = pending_sections_.erase(iter)) {
+      submit(std::move(iter->second));
+      ++next_section_;
+    }
+  }
+
+  void Writer::submit(fmt::memory_buffer& buffer) {
+    auto block = fmt::to_string(buffer);
+    buffer.clear();
+    submit(std::move(block));
+  }
+
+  void Writer::submit(std::string block) {
+    if (block.empty()) return;
+
+    std::unique_lock lock{queue_mutex_};
+    queue_changed_.wait(lock, [this] { return queue_.size() < MAX_PENDING_BLOCKS || error_; });
+    // blocks are dropped after a failed write, the error is thrown by close
+    if (error_) return;
+    queue_.push_back(std::move(block));
+    lock.unlock();
+    queue_changed_.notify_all();
+  }
+
+  void Writer::run_writer() {
+    std::unique_lock lock{queue_mutex_};
+    while (true) {
+      queue_changed_.wait(lock, [this] { return !queue_.empty() || closing_; });
+      if (queue_.empty()) return;
+
+      auto block = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      queue_changed_.notify_all();
+
+      auto error = std::exception_ptr{nullptr};
+      try {
+        write_text(block);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      lock.lock();
+      if (error) {
+        error_ = error;
+        queue_.clear();
+        queue_changed_.notify_all();
+      }
+    }
+  }
+
+  void Writer::close() {
+    if (!writer_thread_.joinable()) return;
+
+    {
+      // sections of tasks which did not finish keep their order
+      std::lock_guard lock{sections_mutex_};
+      for (auto& [index, block] : pending_sections_) submit(std::move(block));
+      pending_sections_.clear();
+    }
+    {
+      std::lock_guard lock{buffers_mutex_};
+      for (auto& [thread_id, buffer] : buffers_) {
+        if (buffer->size() > 0) submit(*buffer);
+      }
+      buffers_.clear();
+    }
+    {
+      std::lock_guard lock{queue_mutex_};
+      closing_ = true;
+    }
+    queue_changed_.notify_all();
+    writer_thread_.join();
+
+    if (bgzf_ != nullptr) {
+      // closing flushes the last blocks and writes the eof block
+      if (bgzf_close(bgzf_.release()) < 0 && !error_) {
+        error_ = std::make_exception_ptr(binary::VcfReaderError("Failed to close " + filename_));
+      }
+      thread_pool_.reset();
+    } else {
+      ofs_.close();
+    }
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  // only called before the writer thread starts and from the writer thread
+  void Writer::write_text(std::string_view text) {
+    if (text.empty()) return;
+    if (bgzf_ != nullptr) {
+      if (bgzf_write(bgzf_.get(), text.data(), text.size()) < 0) {
+        throw binary::VcfReaderError("Failed to write " + filename_);
+      }
+    } else if (!ofs_.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+      throw binary::VcfReaderError("Failed to write " + filename_);
+    }
+  }
+
+  void Writer::write(std::string_view line) {
+    auto& buffer = local_buffer();
+    buffer.append(line.data(), line.data() + line.size());
+    buffer.push_back('\n');
+    if (buffer.size() >= FLUSH_SIZE) submit(buffer);
   }
 
   std::string Writer::format_keys(const Sv2nlVcfRecord& record) {
+    auto buffer = fmt::memory_buffer{};
+    format_keys(buffer, record);
+    return fmt::to_string(buffer);
+  }
+
+  void Writer::format_keys(fmt::memory_buffer& buffer, const Sv2nlVcfRecord& record) {
     if (record.info->svtype == "TRA" || record.info->svtype == "BND") {
-      return fmt::format("{},{}\t{}\t{}\t{}", record.chrom, record.info->chr2, record.pos + 1,
-                         record.info->svend, record.info->svtype);
+      fmt::format_to(std::back_inserter(buffer), "{},{}\t{}\t{}\t{}", record.chrom,
+                     record.info->chr2, record.pos + 1, record.info->svend, record.info->svtype);
+      return;
     }
-    return fmt::format("{}\t{}\t{}\t{}", record.chrom, record.pos + 1, record.info->svend,
-                       record.info->svtype);
-  }  // namespace v2
-}  // namespace sv2nl
\ No newline at end of file
+    fmt::format_to(std::back_inserter(buffer), "{}\t{}\t{}\t{}", record.chrom, record.pos + 1,
+                   record.info->svend, record.info->svtype);
+  }
+}  // namespace sv2nl
@@ -11,6 +11,8 @@ DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
 #include <algorithm>
 #include <array>
 #include <filesystem>
+#include <iterator>
+#include <vector>
 DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
 
 TEST_SUITE("algorithm-interval-tree") {
@@ -136,6 +138,31 @@ TEST_SUITE("algorithm-interval-tree") {
       CHECK_EQ(intervals2.size(), 5);
     }
 
+    SUBCASE("test visit overlaps") {
+      auto lows = std::vector<unsigned>{};
+      interval_tree.visit_overlaps(UIntInterval{7u, 25u},
+                                   [&lows](UIntInterval const& interval) {
+                                     lows.push_back(interval.low);
+                                   });
+      CHECK_EQ(lows.size(), 8);
+      CHECK(std::ranges::is_sorted(lows));
+
+      auto visited = 0;
+      interval_tree.visit_overlaps(UIntInterval{7u, 25u}, [&visited](UIntInterval const&) {
+        ++visited;
+        return visited < 3;
+      });
+      CHECK_EQ(visited, 3);
+    }
+
+    SUBCASE("test find overlaps to output iterator") {
+      auto intervals = std::vector<UIntInterval>{};
+      auto out = interval_tree.find_overlaps(UIntInterval{15u, 25u}, std::back_inserter(intervals));
+      CHECK_EQ(intervals.size(), 5);
+      *out = UIntInterval{0u, 1u};
+      CHECK_EQ(intervals.size(), 6);
+    }
+
     SUBCASE("test to dot") {
       CHECK_NOTHROW(interval_tree.to_dot("interval_tree.dot"));
       CHECK(std::filesystem::exists("interval_tree.dot"));
@@ -154,5 +181,23 @@ TEST_SUITE("algorithm-interval-tree") {
     CHECK_EQ(res.size(), 4);
   }
 
+  TEST_CASE("test find overlaps in deep tree") {
+    // sorted inserts rotate on every insert and build the deepest red black trees
+    IntervalTree<IntIntervalNode> interval_tree{};
+    for (int i = 0; i < 100000; ++i) {
+      interval_tree.insert_node(i * 10, i * 10 + 15);
+    }
+    CHECK_EQ(interval_tree.size(), 100000);
+
+    auto lows = std::vector<int>{};
+    interval_tree.visit_overlaps(IntInterval{500005, 500035},
+                                 [&lows](IntInterval const& interval) {
+                                   lows.push_back(interval.low);
+                                 });
+    CHECK_EQ(lows.size(), 5);
+    CHECK_EQ(lows.front(), 499990);
+    CHECK_EQ(lows.back(), 500030);
+  }
+
   TEST_CASE("test delete") {}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
 #include <array>
 #include <filesystem>
 #include <random>
+#include <vector>
 DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
 
 int black_height(auto const& root, auto const& nil) {
@@ -322,4 +323,36 @@ TEST_SUITE("algorithm-red-black-tree") {
     CHECK_NOTHROW(tree.to_dot("rb_tree.dot"));
     CHECK_NOTHROW(std::filesystem::remove("rb_tree.dot"));
   }
-}
\ No newline at end of file
+
+  TEST_CASE("test in order and range iteration") {
+    using namespace binary::algorithm::tree;
+    std::array<IntNode::key_type, 20> k1{54942, 75803, 49212, 64167, 14933, 44543, 10072,
+                                         90303, 45511, 70641, 59710, 3100,  98544, 55068,
+                                         45575, 4994,  66267, 24721, 17128, 72975};
+    RbTree<IntNode> tree{};
+    CHECK(tree.empty());
+    CHECK(tree.begin() == tree.end());
+    tree.insert_node(k1);
+    CHECK_FALSE(tree.empty());
+
+    auto keys = std::vector<IntNode::key_type>{};
+    for (auto const& node : tree) keys.push_back(node.key);
+    std::ranges::sort(k1);
+    CHECK(std::ranges::equal(keys, k1));
+    CHECK_EQ(tree.size(tree.root()->leftr()) + tree.size(tree.root()->rightr()) + 1, 20);
+
+    auto range_keys = std::vector<IntNode::key_type>{};
+    for (auto const& node : tree.range(44543, 59710)) range_keys.push_back(node.key);
+    CHECK_EQ(range_keys.size(), 7);
+    CHECK_EQ(range_keys.front(), 44543);
+    CHECK_EQ(range_keys.back(), 59710);
+    CHECK(tree.range(99000, 99999).empty());
+
+    tree.delete_node(tree.root());
+    CHECK_EQ(tree.size(), 19);
+    CHECK_EQ(std::ranges::distance(tree.begin(), tree.end()), 19);
+
+    auto moved = std::move(tree);
+    CHECK_EQ(moved.size(), 19);
+  }
+}
@@ -0,0 +1,240 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include <binary/algorithm/all.hpp>
+
+#include "doctest/doctest.h"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+TEST_SUITE("algorithm-static-interval-index") {
+  using namespace binary::algorithm::tree;
+
+  auto brute_force_overlaps(std::vector<IntInterval> const& intervals,
+                            IntInterval const& interval) {
+    auto ret = std::vector<IntInterval>{};
+    std::ranges::copy_if(intervals, std::back_inserter(ret),
+                         [&](auto const& other) { return interval.is_overlap(other); });
+    std::ranges::stable_sort(ret, {}, &IntInterval::low);
+    return ret;
+  }
+
+  auto same_intervals(std::vector<IntInterval> const& lhs, std::vector<IntInterval> const& rhs) {
+    return std::ranges::equal(lhs, rhs, [](auto const& left, auto const& right) {
+      return left.low == right.low && left.high == right.high;
+    });
+  }
+
+  TEST_CASE("test build static interval index") {
+    StaticIntervalIndex<UIntInterval> empty_index{};
+    CHECK(empty_index.empty());
+    CHECK_FALSE(empty_index.find_overlap(1u, 2u).has_value());
+    CHECK(empty_index.find_overlaps(1u, 2u).empty());
+
+    std::array<UIntInterval, 3> nodes{UIntInterval(16u, 21u), UIntInterval(8u, 9u),
+                                      UIntInterval(5u, 8u)};
+    StaticIntervalIndex<UIntInterval> index{nodes};
+    CHECK_EQ(index.size(), 3);
+    CHECK_EQ(index.intervals()[0].low, 5u);
+    CHECK_EQ(index.intervals()[2].low, 16u);
+  }
+
+  TEST_CASE("test static index find overlap") {
+    std::array<UIntInterval, 10> nodes{UIntInterval(16u, 21u), UIntInterval(8u, 9u),
+                                       UIntInterval(5u, 8u),   UIntInterval(0u, 3u),
+                                       UIntInterval(6u, 10u),  UIntInterval(15u, 23u),
+                                       UIntInterval(25u, 30u), UIntInterval(17u, 19u),
+                                       UIntInterval(19u, 20u), UIntInterval(26u, 26u)};
+    StaticIntervalIndex<UIntInterval> index{nodes};
+
+    SUBCASE("test find single overlap") {
+      auto interval = index.find_overlap(22u, 25u);
+      CHECK(interval.has_value());
+      CHECK_EQ(interval->low, 15u);
+      CHECK_EQ(interval->high, 23u);
+
+      CHECK_FALSE(index.find_overlap(UIntInterval{100u, 111u}).has_value());
+    }
+
+    SUBCASE("test find multiple overlaps") {
+      CHECK_EQ(index.find_overlaps(UIntInterval{7u, 25u}).size(), 8);
+      CHECK_EQ(index.find_overlaps(15u, 25u).size(), 5);
+      CHECK_EQ(index.find_overlaps(0u, 0u).size(), 1);
+    }
+
+    SUBCASE("test visit overlaps without copies") {
+      auto addresses = std::vector<UIntInterval const*>{};
+      index.visit_overlaps(UIntInterval{7u, 25u}, [&addresses](UIntInterval const& interval) {
+        addresses.push_back(&interval);
+      });
+      CHECK_EQ(addresses.size(), 8);
+      for (auto const* address : addresses) {
+        CHECK(address >= index.intervals().data());
+        CHECK(address < index.intervals().data() + index.size());
+      }
+
+      auto visited = 0;
+      index.visit_overlaps(UIntInterval{7u, 25u}, [&visited](UIntInterval const&) {
+        ++visited;
+        return visited < 2;
+      });
+      CHECK_EQ(visited, 2);
+    }
+
+    SUBCASE("test find overlaps to output iterator") {
+      auto intervals = std::vector<UIntInterval>{};
+      index.find_overlaps(UIntInterval{15u, 25u}, std::back_inserter(intervals));
+      CHECK_EQ(intervals.size(), 5);
+      CHECK(std::ranges::is_sorted(intervals, {}, &UIntInterval::low));
+    }
+  }
+
+  TEST_CASE("test static index agrees with brute force") {
+    auto engine = std::mt19937{42};
+    auto position = std::uniform_int_distribution<int>{0, 10000};
+    auto length = std::uniform_int_distribution<int>{0, 500};
+
+    // sizes around powers of two exercise the nodes past the end of the implicit tree
+    for (auto size : {1, 2, 3, 7, 8, 9, 15, 16, 17, 100, 1000, 1025}) {
+      auto intervals = std::vector<IntInterval>{};
+      for (int i = 0; i < size; ++i) {
+        auto low = position(engine);
+        intervals.emplace_back(low, low + length(engine));
+      }
+      StaticIntervalIndex<IntInterval> index{intervals};
+      CHECK_EQ(index.size(), intervals.size());
+
+      for (int i = 0; i < 200; ++i) {
+        auto low = position(engine);
+        auto query = IntInterval{low, low + length(engine)};
+        auto expected = brute_force_overlaps(intervals, query);
+
+        CHECK(same_intervals(index.find_overlaps(query), expected));
+        CHECK_EQ(index.find_overlap(query).has_value(), !expected.empty());
+      }
+    }
+  }
+
+  TEST_CASE("test sweep overlaps of sorted queries") {
+    auto engine = std::mt19937{7};
+    auto position = std::uniform_int_distribution<int>{0, 10000};
+    auto length = std::uniform_int_distribution<int>{0, 800};
+
+    auto intervals = std::vector<IntInterval>{};
+    for (int i = 0; i < 2000; ++i) {
+      auto low = position(engine);
+      intervals.emplace_back(low, low + length(engine));
+    }
+    StaticIntervalIndex<IntInterval> index{intervals};
+
+    auto queries = std::vector<IntInterval>{};
+    for (int i = 0; i < 500; ++i) {
+      auto low = position(engine);
+      queries.emplace_back(low, low + length(engine));
+    }
+
+    auto check_sweep = [&] {
+      auto pairs = std::vector<std::vector<IntInterval>>(queries.size());
+      auto last_position = std::size_t{0};
+      auto in_order = true;
+      index.sweep_overlaps(queries, [&](std::size_t query_position, IntInterval const& overlap) {
+        in_order = in_order && query_position >= last_position;
+        last_position = query_position;
+        pairs[query_position].push_back(overlap);
+      });
+      CHECK(in_order);
+
+      for (std::size_t i = 0; i < queries.size(); ++i) {
+        CHECK(same_intervals(pairs[i], index.find_overlaps(queries[i])));
+      }
+    };
+
+    SUBCASE("sorted queries") {
+      std::ranges::sort(queries, {}, &IntInterval::low);
+      check_sweep();
+    }
+
+    SUBCASE("queries out of order") { check_sweep(); }
+  }
+
+  TEST_CASE("test parallel overlaps of many queries") {
+    auto engine = std::mt19937{11};
+    auto position = std::uniform_int_distribution<int>{0, 20000};
+    auto length = std::uniform_int_distribution<int>{0, 600};
+
+    auto intervals = std::vector<IntInterval>{};
+    for (int i = 0; i < 3000; ++i) {
+      auto low = position(engine);
+      intervals.emplace_back(low, low + length(engine));
+    }
+    StaticIntervalIndex<IntInterval> index{intervals};
+
+    auto queries = std::vector<IntInterval>{};
+    for (int i = 0; i < 5000; ++i) {
+      auto low = position(engine);
+      queries.emplace_back(low, low + length(engine));
+    }
+    std::ranges::sort(queries, {}, &IntInterval::low);
+
+    auto expected = std::vector<std::pair<std::size_t, IntInterval>>{};
+    index.sweep_overlaps(queries, [&](std::size_t query_position, IntInterval const& overlap) {
+      expected.emplace_back(query_position, overlap);
+    });
+
+    auto same_pairs = [&](std::vector<std::pair<std::size_t, IntInterval>> const& pairs) {
+      return std::ranges::equal(pairs, expected, [](auto const& left, auto const& right) {
+        return left.first == right.first && left.second.low == right.second.low
+               && left.second.high == right.second.high;
+      });
+    };
+
+    SUBCASE("find overlaps in the order of queries") {
+      for (auto num_threads : {1, 2, 4, 0}) {
+        CHECK(same_pairs(index.parallel_find_overlaps(queries, num_threads)));
+      }
+      CHECK(index.parallel_find_overlaps(std::vector<IntInterval>{}, 4).empty());
+    }
+
+    SUBCASE("visit overlaps from many threads") {
+      auto pairs = std::vector<std::pair<std::size_t, IntInterval>>{};
+      auto mutex = std::mutex{};
+      index.parallel_visit_overlaps(
+          queries,
+          [&](std::size_t query_position, IntInterval const& overlap) {
+            std::lock_guard lock{mutex};
+            pairs.emplace_back(query_position, overlap);
+          },
+          4);
+      std::ranges::sort(pairs, [](auto const& left, auto const& right) {
+        return std::pair{left.first, left.second.low} < std::pair{right.first, right.second.low};
+      });
+      std::ranges::sort(expected, [](auto const& left, auto const& right) {
+        return std::pair{left.first, left.second.low} < std::pair{right.first, right.second.low};
+      });
+      CHECK_EQ(pairs.size(), expected.size());
+      CHECK(std::ranges::equal(pairs, expected, [](auto const& left, auto const& right) {
+        return left.first == right.first && left.second.low == right.second.low;
+      }));
+    }
+
+    SUBCASE("exceptions of visitors are rethrown") {
+      CHECK_THROWS_AS(index.parallel_visit_overlaps(
+                          queries,
+                          [](std::size_t query_position, IntInterval const&) {
+                            if (query_position == 4000) throw std::runtime_error("stop");
+                          },
+                          4),
+                      std::runtime_error);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+//
+// Created by li002252 on 10/18/22.
+//
+#include <binary/parser/contig.hpp>
+#include <binary/parser/vcf.hpp>
+
+#include "doctest/doctest.h"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+TEST_SUITE("parser-contig") {
+  using binary::parser::Contig;
+
+  TEST_CASE("test intern contig") {
+    auto chr1 = Contig{"chr1"};
+    auto chr2 = Contig{"chr2"};
+
+    CHECK_EQ(chr1, Contig{"chr1"});
+    CHECK_EQ(chr1.id(), Contig{std::string("chr1")}.id());
+    CHECK_NE(chr1, chr2);
+    CHECK_EQ(chr1.name(), "chr1");
+    CHECK_EQ(chr1, "chr1");
+    CHECK_LT(chr1, chr2);
+    CHECK_GT(Contig{"chr10"}, chr1);
+
+    SUBCASE("test default contig") {
+      CHECK(Contig{}.empty());
+      CHECK_EQ(Contig{}.id(), -1);
+      CHECK_EQ(Contig{""}, Contig{});
+      CHECK_LT(Contig{}, chr1);
+    }
+
+    SUBCASE("test contig output and hash") {
+      std::ostringstream os{};
+      os << chr2;
+      CHECK_EQ(os.str(), "chr2");
+
+      auto contigs = std::unordered_set<Contig>{chr1, chr2, Contig{"chr1"}};
+      CHECK_EQ(contigs.size(), 2);
+    }
+
+    SUBCASE("test sort contigs by name") {
+      auto contigs = std::vector<Contig>{Contig{"chrX"}, chr2, chr1};
+      std::ranges::sort(contigs);
+      auto expected = std::vector<Contig>{chr1, chr2, Contig{"chrX"}};
+      CHECK_EQ(contigs, expected);
+    }
+  }
+
+  TEST_CASE("test contig of vcf records") {
+    using namespace binary::parser::vcf;
+    auto vcf_ranges = VcfRanges<VcfRecord>("../../test/data/debug.vcf.gz");
+
+    auto chr10 = Contig{"chr10"};
+    CHECK_EQ(std::ranges::count_if(vcf_ranges,
+                                   [&chr10](auto const& record) { return record.chrom == chr10; }),
+             3);
+
+    auto uncompressed = VcfRanges<VcfRecord>("../../test/data/debug_uncom.vcf");
+    CHECK_EQ(vcf_ranges.begin()->chrom, uncompressed.begin()->chrom);
+  }
+}
@@ -0,0 +1,73 @@
+//
+// Created by li002252 on 10/18/22.
+//
+#include <binary/parser/info_schema.hpp>
+#include <binary/parser/vcf.hpp>
+#include <binary/parser/vcf_text.hpp>
+
+#include "doctest/doctest.h"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <string_view>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+TEST_SUITE("parser-info-schema") {
+  using namespace binary::parser::vcf;
+
+  using SvSchema = InfoSchema<InfoKey<"SVTYPE", char>, InfoKey<"SVEND", pos_t>,
+                              InfoKey<"CHR2", char>, InfoKey<"PSO", float>,
+                              InfoKey<"CANONICAL", bool>, InfoKey<"PRECISE", bool>>;
+
+  static_assert(SvSchema::index_of<"SVTYPE">() == 0);
+  static_assert(SvSchema::index_of<"PRECISE">() == 5);
+  static_assert(hash_info_key("SVTYPE") != hash_info_key("SVEND"));
+
+  TEST_CASE("test decode text info by schema") {
+    auto schema = SvSchema{};
+    schema.decode("CANONICAL;BOUNDARY=NEITHER;SVTYPE=TRA;CHR2=chr17;SVEND=7705262;PSO=0.364");
+
+    CHECK_EQ(schema.get<"SVTYPE">(), "TRA");
+    CHECK_EQ(schema.get<"SVEND">(), 7705262);
+    CHECK_EQ(schema.get<"CHR2">(), "chr17");
+    CHECK_EQ(schema.get<"PSO">(), doctest::Approx(0.364));
+    CHECK(schema.get<"CANONICAL">());
+    CHECK_FALSE(schema.get<"PRECISE">());
+
+    SUBCASE("test missing keys of next record") {
+      schema.decode("SVTYPE=INS;PRECISE");
+      CHECK_EQ(schema.get<"SVTYPE">(), "INS");
+      CHECK(schema.get<"PRECISE">());
+      CHECK_FALSE(schema.get<"CANONICAL">());
+      CHECK_FALSE(schema.has<"SVEND">());
+      CHECK_THROWS_AS(schema.get<"SVEND">(), binary::VcfReaderError);
+    }
+  }
+
+  TEST_CASE("test decode text vcf by schema") {
+    auto reader = VcfTextReader("../../test/data/debug_uncom.vcf");
+    auto line = VcfTextLine{};
+    auto schema = SvSchema{};
+
+    std::vector<std::string_view> svtypes{};
+    while (reader.next(line)) {
+      schema.decode(line.info);
+      svtypes.push_back(schema.get<"SVTYPE">());
+    }
+    auto expected = std::vector<std::string_view>{"TRA", "TRA", "INS", "TDUP", "TDUP", "TDUP"};
+    CHECK_EQ(svtypes, expected);
+  }
+
+  TEST_CASE("test decode vcf record by schema") {
+    auto vcf_ranges = VcfRanges<VcfRecord>("../../test/data/debug.vcf.gz");
+    auto schema = SvSchema{};
+
+    auto iter = vcf_ranges.begin();
+    iter->decode_info(schema);
+    CHECK_EQ(schema.get<"SVTYPE">(), "TRA");
+    CHECK_EQ(schema.get<"SVEND">(), 7705262);
+    CHECK_EQ(schema.get<"CHR2">(), "chr17");
+    CHECK(schema.get<"CANONICAL">());
+    CHECK_FALSE(schema.has<"PRECISE">());
+  }
+}
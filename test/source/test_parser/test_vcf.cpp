@@ -12,7 +12,13 @@
 
 DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <ranges>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
 
 void test_vcf_query(std::string_view file_path) {
@@ -22,19 +28,34 @@ void test_vcf_query(std::string_view file_path) {
 
   spdlog::debug("[test vcf query] {}", vcf_ranges.file_path());
   CHECK_EQ(vcf_ranges.has_read_index(), false);
-  for (auto i = vcf_ranges.query("chr17", 7707250, 7798250); i != vcf_ranges.end();
-       i = vcf_ranges.iter_query_record()) {
-    auto record = *i;
+  for (auto const& record : vcf_ranges.query("chr17", 7707250, 7798250)) {
     spdlog::debug("[test vcf] {}", record);
   }
 
-  for (auto i = vcf_ranges.query("chr10"); i != vcf_ranges.end();
-       i = vcf_ranges.iter_query_record()) {
-    spdlog::debug("[test vcf query only chrom] {}", *i);
+  for (auto const& record : vcf_ranges.query("chr10")) {
+    spdlog::debug("[test vcf query only chrom] {}", record);
   }
   CHECK_EQ(vcf_ranges.has_read_index(), true);
 }
 
+// write the decompressed content of a bgzipped file
+void decompress_bgzf(std::string const& file_path, std::string const& output_path) {
+  auto* input = bgzf_open(file_path.c_str(), "r");
+  REQUIRE(input != nullptr);
+  auto output = std::ofstream(output_path, std::ios::binary);
+  auto buffer = std::vector<char>(1 << 16);
+  for (ssize_t size{}; (size = bgzf_read(input, buffer.data(), buffer.size())) > 0;) {
+    output.write(buffer.data(), size);
+  }
+  bgzf_close(input);
+}
+
+// keys are fixed by the type, so records of it can be default constructed
+struct SvInfoFactory
+    : binary::parser::vcf::InfoFieldFactory<char, binary::parser::vcf::pos_t, bool> {
+  SvInfoFactory() : InfoFieldFactory("SVTYPE", "SVEND", "CANONICAL") {}
+};
+
 void test_vcf_iter(std::string_view file_path) {
   using namespace binary::parser::vcf;
   auto vcf_reader = VcfRanges<VcfRecord>{std::string(file_path)};
@@ -70,6 +91,28 @@ TEST_SUITE("parser-vcf") {
 
   TEST_CASE("test vcf query") { CHECK_NOTHROW(test_vcf_query(file_path)); }
 
+  TEST_CASE("test vcf query ranges") {
+    auto query_ranges = VcfRanges<VcfRecord>(file_path);
+
+    CHECK_EQ(std::ranges::distance(query_ranges.query("chr10")), 3);
+    CHECK_EQ(std::ranges::distance(query_ranges.query("chr17", 7707250, 7798250)), 2);
+    CHECK_EQ(std::ranges::distance(query_ranges.query("chr1")), 0);
+
+    SUBCASE("test query ranges can be iterated twice") {
+      auto chr10 = query_ranges.query("chr10");
+      CHECK_EQ(std::ranges::distance(chr10), 3);
+      CHECK_EQ(std::ranges::distance(chr10), 3);
+    }
+
+    SUBCASE("test query ranges with views") {
+      auto chroms = query_ranges.query("chr10")
+                    | std::views::transform([](auto const& record) { return record.chrom; });
+      CHECK(std::ranges::all_of(chroms, [](auto const& chrom) { return chrom == "chr10"; }));
+    }
+
+    SUBCASE("test query unknown chromosome") { CHECK_THROWS(query_ranges.query("chrUnknown")); }
+  }
+
   TEST_CASE("testing vcf.hpp") {
     SUBCASE("test file path") {
       CHECK_EQ(vcf_ranges.file_path(), file_path);
@@ -83,6 +126,19 @@ TEST_SUITE("parser-vcf") {
     SUBCASE("test query vcf without index") {
       CHECK_THROWS(test_vcf_query(std::string(uncompressed_file_path)));
     }
+    SUBCASE("test query vcf with corrupt index") {
+      namespace fs = std::filesystem;
+      constexpr const char* corrupt_file_path = "test_corrupt_index.vcf.gz";
+      fs::copy_file(file_path, corrupt_file_path, fs::copy_options::overwrite_existing);
+      std::ofstream(std::string(corrupt_file_path) + ".tbi") << "not an index";
+      {
+        auto corrupt_ranges = VcfRanges<VcfRecord>(corrupt_file_path);
+        CHECK(corrupt_ranges.has_index_file());
+        CHECK_THROWS_AS(corrupt_ranges.query("chr10"), binary::VcfReaderError);
+      }
+      fs::remove(corrupt_file_path);
+      fs::remove(std::string(corrupt_file_path) + ".tbi");
+    }
   }
 
   TEST_CASE("testing read record") {
@@ -107,6 +163,51 @@ TEST_SUITE("parser-vcf") {
     }
   }
 
+  TEST_CASE("test read all record with decompression threads") {
+    VcfRanges<VcfRecord> threaded_ranges(file_path);
+    threaded_ranges.set_threads(2);
+    CHECK_EQ(threaded_ranges.get_threads(), 2);
+
+    VcfRanges<VcfRecord> threaded_ranges_copy(threaded_ranges);
+    CHECK_EQ(threaded_ranges_copy.get_threads(), 2);
+
+    CHECK_EQ(std::ranges::distance(threaded_ranges), 6);
+    CHECK_EQ(std::ranges::distance(threaded_ranges_copy), 6);
+  }
+
+  TEST_CASE("test lazy info") {
+    auto lazy_ranges = VcfRanges<VcfRecord>(file_path);
+    lazy_ranges.set_lazy_info(true);
+    CHECK(lazy_ranges.get_lazy_info());
+
+    auto it = lazy_ranges.begin();
+    CHECK(it->info.is_pending());
+    CHECK_EQ(it->info->svtype, "TRA");
+    CHECK_FALSE(it->info.is_pending());
+
+    SUBCASE("test lazy info of copied record") {
+      ++it;
+      auto copy = *it;
+      CHECK(copy.info.is_pending());
+      ++it;
+      CHECK_THROWS_AS(copy.info->svtype, binary::VcfReaderError);
+    }
+
+    SUBCASE("test lazy info with views") {
+      auto tdup = lazy_ranges | std::views::filter([](auto const& record) {
+                    return record.chrom == "chr17";
+                  })
+                  | std::views::transform([](auto const& record) { return record.info->svtype; });
+      CHECK(std::ranges::all_of(tdup, [](auto const& svtype) { return svtype == "TDUP"; }));
+      CHECK_EQ(std::ranges::distance(tdup), 2);
+    }
+
+    SUBCASE("test eager info is not pending") {
+      auto eager_ranges = VcfRanges<VcfRecord>(file_path);
+      CHECK_FALSE(eager_ranges.begin()->info.is_pending());
+    }
+  }
+
   TEST_CASE("test std algorithm usage") {
     std::ranges::for_each(vcf_ranges,
                           [](auto record) { spdlog::debug("[test std algorithm] {}", record); });
@@ -116,8 +217,182 @@ TEST_SUITE("parser-vcf") {
         std::ranges::count_if(vcf_ranges, [](auto record) { return record.chrom == "chr10"; }));
   }
 
+  TEST_CASE("test cursors share header of vcf handle") {
+    // htslib writes to the header while parsing text records
+    auto handle = details::VcfHandle(file_path);
+    auto cursor1 = handle.open();
+    auto cursor2 = handle.open(2);
+    CHECK_NE(cursor1->header.get(), handle.header());
+    CHECK_NE(cursor1->header, cursor2->header);
+
+    REQUIRE_EQ(cursor1->read(), 0);
+    REQUIRE_EQ(cursor2->read(), 0);
+    CHECK_EQ(cursor1->record->pos, 93567288 - 1);
+    CHECK_EQ(cursor2->record->pos, 93567288 - 1);
+    CHECK_EQ(cursor1->contig(cursor1->record->rid), cursor2->contig(cursor2->record->rid));
+
+    SUBCASE("test cursors of bcf share the parsed header") {
+      auto bcf_handle = details::VcfHandle("../../test/data/debug.bcf");
+      auto bcf_cursor1 = bcf_handle.open();
+      auto bcf_cursor2 = bcf_handle.open(2);
+      CHECK_EQ(bcf_cursor1->header.get(), bcf_handle.header());
+      CHECK_EQ(bcf_cursor1->header, bcf_cursor2->header);
+
+      REQUIRE_EQ(bcf_cursor1->read(), 0);
+      REQUIRE_EQ(bcf_cursor2->read(), 0);
+      CHECK_EQ(bcf_cursor1->record->pos, 93567288 - 1);
+      CHECK_EQ(bcf_cursor2->record->pos, 93567288 - 1);
+    }
+
+    SUBCASE("test cursors of uncompressed vcf parse their own header") {
+      auto uncompressed = details::VcfHandle(uncompressed_file_path);
+      auto cursor = uncompressed.open();
+      CHECK_NE(cursor->header.get(), uncompressed.header());
+      REQUIRE_EQ(cursor->read(), 0);
+      CHECK_EQ(cursor->record->pos, 93567288 - 1);
+    }
+  }
+
+  TEST_CASE("test query shared vcf ranges from threads") {
+    auto shared_ranges = VcfRanges<VcfRecord>(file_path).share();
+
+    std::vector<std::ptrdiff_t> chr10_counts(4);
+    std::vector<std::ptrdiff_t> all_counts(4);
+    {
+      std::vector<std::jthread> workers{};
+      for (std::size_t i = 0; i < chr10_counts.size(); ++i) {
+        workers.emplace_back([cursor = shared_ranges, &chr10_counts, &all_counts, i] {
+          chr10_counts[i] = std::ranges::distance(cursor.query("chr10"));
+          all_counts[i] = std::ranges::distance(cursor);
+        });
+      }
+    }
+
+    CHECK(std::ranges::all_of(chr10_counts, [](auto count) { return count == 3; }));
+    CHECK(std::ranges::all_of(all_counts, [](auto count) { return count == 6; }));
+  }
+
+  TEST_CASE("test read chunks of bgzf blocks") {
+    // same records as debug.vcf.gz, records cross the small bgzf blocks
+    auto block_ranges = VcfRanges<VcfRecord>("../../test/data/debug_blocks.vcf.gz");
+
+    std::vector<pos_t> expected{};
+    for (auto const& record : vcf_ranges) expected.push_back(record.pos);
+
+    for (std::size_t n_chunks : {1, 4, 8}) {
+      auto chunks = block_ranges.chunks(n_chunks);
+      CHECK_LE(chunks.size(), n_chunks);
+
+      std::vector<pos_t> positions{};
+      for (auto const& chunk : chunks) {
+        for (auto const& record : chunk) positions.push_back(record.pos);
+      }
+      CHECK_EQ(positions, expected);
+    }
+
+    SUBCASE("test chunks of uncompressed vcf") {
+      auto uncompressed = VcfRanges<VcfRecord>(uncompressed_file_path);
+      auto chunks = uncompressed.chunks(4);
+      CHECK_EQ(chunks.size(), 1);
+      CHECK_EQ(std::ranges::distance(chunks.front()), 6);
+    }
+
+    SUBCASE("test parallel for each chunk") {
+      std::vector<std::vector<pos_t>> chunk_positions(4);
+      block_ranges.parallel_for_each(4, [&chunk_positions](std::size_t i, auto const& record) {
+        chunk_positions[i].push_back(record.pos);
+      });
+
+      std::vector<pos_t> positions{};
+      for (auto const& chunk : chunk_positions) {
+        positions.insert(positions.end(), chunk.begin(), chunk.end());
+      }
+      CHECK_EQ(positions, expected);
+    }
+  }
+
+  TEST_CASE("test parallel chunks read the same records") {
+    // records have FORMAT and sample columns, which htslib parses with the header
+    using record_key = std::tuple<std::string, pos_t, std::string, pos_t>;
+    auto block_ranges = VcfRanges<VcfRecord>("../../test/data/debug_blocks.vcf.gz");
+    REQUIRE_GT(block_ranges.chunks(8).size(), 1);
+
+    std::vector<record_key> expected{};
+    for (auto const& record : vcf_ranges) {
+      expected.emplace_back(std::string(record.chrom.name()), record.pos, record.info->svtype,
+                            record.info->svend);
+    }
+
+    for (int round = 0; round < 20; ++round) {
+      std::vector<std::vector<record_key>> chunk_records(8);
+      block_ranges.parallel_for_each(8, [&chunk_records](std::size_t i, auto const& record) {
+        chunk_records[i].emplace_back(std::string(record.chrom.name()), record.pos,
+                                      record.info->svtype, record.info->svend);
+      });
+
+      std::vector<record_key> records{};
+      for (auto const& chunk : chunk_records) {
+        records.insert(records.end(), chunk.begin(), chunk.end());
+      }
+      CHECK_EQ(records, expected);
+    }
+  }
+
+  TEST_CASE("test plain vcf is read by the text reader") {
+    using record_key = std::tuple<std::string, pos_t, pos_t, std::string, pos_t>;
+    constexpr const char* plain_file_path = "test_plain_debug.vcf";
+    static_assert(VcfRecord::is_text_readable);
+    decompress_bgzf(file_path, plain_file_path);
+
+    auto keys = [](auto const& ranges) {
+      std::vector<record_key> result{};
+      for (auto const& record : ranges) {
+        result.emplace_back(std::string(record.chrom.name()), record.pos, record.rlen,
+                            record.info->svtype, record.info->svend);
+      }
+      return result;
+    };
+
+    // htslib reads the bgzipped file, the text reader reads the same lines
+    auto expected = keys(vcf_ranges);
+    auto plain_ranges = VcfRanges<VcfRecord>(plain_file_path);
+    CHECK_EQ(keys(plain_ranges), expected);
+    CHECK_EQ(keys(plain_ranges.chunks(4).front()), expected);
+
+    SUBCASE("test records of text reader keep the interned contig") {
+      auto records = std::vector<VcfRecord>{};
+      for (auto const& record : plain_ranges) records.push_back(record.materialize());
+      REQUIRE_EQ(records.size(), expected.size());
+      CHECK_EQ(records.front().chrom, Contig{"chr10"});
+      CHECK_EQ(records.front().chrom, vcf_ranges.begin()->chrom);
+    }
+
+    SUBCASE("test lazy info of text reader") {
+      plain_ranges.set_lazy_info(true);
+      CHECK_EQ(keys(plain_ranges), expected);
+    }
+
+    std::filesystem::remove(plain_file_path);
+  }
+
+  TEST_CASE("test dereference shares the current record") {
+    auto iter = vcf_ranges.begin();
+    auto const& record = *iter;
+    CHECK_EQ(&record, &*iter);
+    CHECK_EQ(&record, iter.operator->());
+
+    auto kept = record.materialize();
+    auto copy = iter;
+    ++iter;
+    CHECK_EQ(&*copy, &*iter);
+    CHECK_EQ(kept.info->svtype, "TRA");
+    CHECK_EQ(kept.pos, 93567288 - 1);
+    CHECK_EQ(iter->pos, 93567289 - 1);
+  }
+
   TEST_CASE("test c++20 vcf ") {
-    static_assert(std::forward_iterator<VcfRanges<VcfRecord>::iterator>);
+    static_assert(std::input_iterator<VcfRanges<VcfRecord>::iterator>);
+    static_assert(!std::forward_iterator<VcfRanges<VcfRecord>::iterator>);
 
     for (auto const& record : vcf_ranges | std::views::filter([](auto const& record) {
                                 return record.info->svtype == "TDUP";
@@ -128,6 +403,167 @@ TEST_SUITE("parser-vcf") {
 
   TEST_CASE("test info factory") { InfoFieldFactory<char, pos_t> info_field1("SVTYPE", "SVEND"); }
 
+  TEST_CASE("test info factory decodes text info") {
+    auto info_field = InfoFieldFactory<char, pos_t, float, bool, bool>("SVTYPE", "SVEND", "PSO",
+                                                                       "CANONICAL", "PRECISE");
+    info_field.update("CANONICAL;SVTYPE=TRA;SVEND=7705262;PSO=0.364;TRANSCRIPT_ID=3,4,5");
+
+    CHECK_EQ(std::get<0>(info_field.data_tuple), "TRA");
+    CHECK_EQ(std::get<1>(info_field.data_tuple), 7705262);
+    CHECK_EQ(std::get<2>(info_field.data_tuple), doctest::Approx(0.364));
+    CHECK(std::get<3>(info_field.data_tuple));
+    CHECK_FALSE(std::get<4>(info_field.data_tuple));
+
+    auto missing = InfoFieldFactory<pos_t>("SVEND");
+    CHECK_THROWS_AS(missing.update("SVTYPE=TRA"), binary::VcfReaderError);
+    auto invalid = InfoFieldFactory<pos_t>("SVEND");
+    CHECK_THROWS_AS(invalid.update("SVEND=end"), binary::VcfReaderError);
+  }
+
+  TEST_CASE("test info factory decodes records of plain vcf") {
+    using SvRecord = BaseVcfRecord<SvInfoFactory>;
+    using record_key = std::tuple<std::string, pos_t, std::string, pos_t, bool>;
+    constexpr const char* plain_file_path = "test_plain_factory.vcf";
+    static_assert(SvRecord::is_text_readable);
+    decompress_bgzf(file_path, plain_file_path);
+
+    auto keys = [](auto const& ranges) {
+      std::vector<record_key> result{};
+      for (auto const& record : ranges) {
+        auto const& [svtype, svend, canonical] = record.info->data_tuple;
+        result.emplace_back(std::string(record.chrom.name()), record.pos, svtype, svend,
+                            canonical);
+      }
+      return result;
+    };
+
+    // htslib decodes info of the bgzipped file, the factory decodes the text INFO column
+    auto expected = keys(VcfRanges<SvRecord>(file_path));
+    REQUIRE_EQ(expected.size(), 6);
+    CHECK_EQ(keys(VcfRanges<SvRecord>(plain_file_path)), expected);
+
+    std::filesystem::remove(plain_file_path);
+  }
+
+  TEST_CASE("test info flag") {
+    auto data = std::make_shared<details::DataImpl>(file_path);
+    REQUIRE_EQ(data->read(), 0);
+
+    CHECK(get_info_field<bool>("CANONICAL", data->header.get(), data->record.get()));
+    CHECK_FALSE(get_info_field<bool>("NONCANONICAL", data->header.get(), data->record.get()));
+  }
+
+  TEST_CASE("test read indexed bcf") {
+    // same records as debug.vcf.gz, indexed by csi
+    constexpr const char* bcf_file_path = "../../test/data/debug.bcf";
+    auto bcf_ranges = VcfRanges<VcfRecord>(bcf_file_path);
+    CHECK(bcf_ranges.has_index_file());
+
+    auto same_records = [](auto&& bcf_records, auto&& vcf_records) {
+      auto expected = std::vector<std::tuple<std::string, pos_t, std::string, pos_t>>{};
+      for (auto const& record : vcf_records) {
+        expected.emplace_back(std::string(record.chrom.name()), record.pos, record.info->svtype,
+                              record.info->svend);
+      }
+      auto records = std::vector<std::tuple<std::string, pos_t, std::string, pos_t>>{};
+      for (auto const& record : bcf_records) {
+        records.emplace_back(std::string(record.chrom.name()), record.pos, record.info->svtype,
+                             record.info->svend);
+      }
+      return !records.empty() && records == expected;
+    };
+
+    SUBCASE("test iterate bcf") {
+      CHECK_EQ(std::ranges::distance(bcf_ranges), 6);
+      CHECK(same_records(bcf_ranges, vcf_ranges));
+    }
+
+    SUBCASE("test query bcf by region") {
+      CHECK(same_records(bcf_ranges.query("chr10"), vcf_ranges.query("chr10")));
+      CHECK(same_records(bcf_ranges.query("chr17", 7707250, 7798250),
+                         vcf_ranges.query("chr17", 7707250, 7798250)));
+      CHECK_EQ(std::ranges::distance(bcf_ranges.query("chr1")), 0);
+      CHECK(same_records(bcf_ranges.query("chr10", 93567289, 93567290),
+                         vcf_ranges.query("chr10", 93567289, 93567290)));
+    }
+
+    SUBCASE("test info flag of bcf") {
+      auto data = std::make_shared<details::DataImpl>(bcf_file_path);
+      REQUIRE(data->is_bcf());
+      REQUIRE_EQ(data->read(), 0);
+
+      CHECK(get_info_field<bool>("CANONICAL", data->header.get(), data->record.get()));
+      CHECK_FALSE(get_info_field<bool>("NONCANONICAL", data->header.get(), data->record.get()));
+      CHECK_EQ(data->info<char>("SVTYPE"), "TRA");
+      CHECK_EQ(data->info<pos_t>("SVEND"), 7705262);
+    }
+  }
+
+  TEST_CASE("test info factory resolves key ids once") {
+    auto data = std::make_shared<details::DataImpl>(file_path);
+    REQUIRE_EQ(data->read(), 0);
+
+    InfoFieldFactory<char, pos_t, bool> info_field("SVTYPE", "SVEND", "CANONICAL");
+    info_field.update(data, "nls");
+    CHECK_EQ(info_field.data_tuple, std::tuple(std::string("TRA"), pos_t{7705262}, true));
+    CHECK_EQ(info_field.key_ids.serial, data->serial);
+
+    auto other = std::make_shared<details::DataImpl>(file_path);
+    REQUIRE_EQ(other->read(), 0);
+    info_field.update(other, "nls");
+    CHECK_EQ(info_field.key_ids.serial, other->serial);
+
+    InfoFieldFactory<int> missing_field("NOT_IN_HEADER");
+    CHECK_THROWS(missing_field.update(data, "nls"));
+  }
+
+  TEST_CASE("test info key ids resolve keys added to the header") {
+    constexpr const char* undeclared_file_path = "test_undeclared_info.vcf";
+    std::ofstream(undeclared_file_path)
+        << "##fileformat=VCFv4.2\n##contig=<ID=chr1>\n"
+           "##INFO=<ID=SVTYPE,Number=1,Type=String,Description=\"Type\">\n"
+           "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n"
+           "chr1\t100\t.\tA\t<TRA>\t.\t.\tSVTYPE=TRA\n"
+           "chr1\t200\t.\tA\t<TRA>\t.\t.\tSVTYPE=TRA;CHR2=chr2\n";
+
+    {
+      auto data = details::DataImpl(undeclared_file_path);
+      constexpr std::array<std::string_view, 2> keys{"SVTYPE", "CHR2"};
+      auto key_ids = details::InfoKeyIds<2>{};
+
+      REQUIRE_EQ(data.read(), 0);
+      CHECK_LT(key_ids.resolve(data, keys)[1], 0);
+
+      // htslib declares CHR2 while parsing the second record
+      REQUIRE_EQ(data.read(), 0);
+      auto const& ids = key_ids.resolve(data, keys);
+      REQUIRE_GE(ids[1], 0);
+      CHECK_EQ(data.info<char>(ids[0], keys[0]), "TRA");
+      CHECK_EQ(data.info<char>(ids[1], keys[1]), "chr2");
+      CHECK_EQ(key_ids.n_header_ids, -1);
+    }
+    std::filesystem::remove(undeclared_file_path);
+  }
+
+  TEST_CASE("test info decoder reuses buffers") {
+    auto data = std::make_shared<details::DataImpl>(file_path);
+    REQUIRE_EQ(data->read(), 0);
+
+    CHECK_EQ(data->info<char>("SVTYPE"), "TRA");
+    CHECK_EQ(data->info<pos_t>("SVEND"), 7705262);
+    CHECK_EQ(data->info<int>("SR"), 2);
+    CHECK(data->info<bool>("CANONICAL"));
+    CHECK_THROWS(data->info<int>("DP"));
+
+    auto const* buffer = data->info_decoder.get<char>("BOUNDARY", data->header.get(),
+                                                      data->record.get())
+                             .data();
+    REQUIRE_EQ(data->read(), 0);
+    auto svtype = data->info<char>("SVTYPE");
+    CHECK_EQ(svtype, "TRA");
+    CHECK_EQ(svtype.data(), buffer);
+  }
+
   TEST_CASE("test construct vcf interval node from vcf record") {
     auto begin = vcf_ranges.begin();
     auto vcf_interval_node = VcfIntervalNode{*begin};
@@ -0,0 +1,77 @@
+//
+// Created by li002252 on 10/18/22.
+//
+#include <binary/parser/vcf_batch.hpp>
+
+#include "doctest/doctest.h"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <algorithm>
+#include <string>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+TEST_SUITE("parser-vcf-batch") {
+  using namespace binary::parser::vcf;
+  constexpr const char* file_path = "../../test/data/debug.vcf.gz";
+
+  TEST_CASE("test svtype names") {
+    CHECK_EQ(to_svtype("TDUP"), SvType::Tdup);
+    CHECK_EQ(to_svtype("CNV"), SvType::Unknown);
+    CHECK_EQ(to_string(SvType::Bnd), "BND");
+    CHECK_EQ(to_string(to_svtype("INV")), "INV");
+  }
+
+  TEST_CASE("test read vcf batch") {
+    auto reader = VcfBatchReader(file_path, VcfBatchKeys{.end = "SVEND"});
+    auto batch = VcfBatch{};
+
+    CHECK_EQ(reader.read_batch(batch, 4), 4);
+    CHECK_EQ(batch.chroms[0], "chr10");
+    CHECK_EQ(batch.pos[0], 93567287);
+    CHECK_EQ(batch.end[0], 7705262);
+    CHECK_EQ(batch.svtypes[0], SvType::Tra);
+    CHECK_EQ(batch.chr2s[0], "chr17");
+    CHECK_EQ(batch.svtypes[2], SvType::Ins);
+    CHECK_EQ(batch.chroms[3], "chr14");
+    CHECK_EQ(batch.svtypes[3], SvType::Tdup);
+    CHECK_EQ(batch.strands[0], VcfBatch::STRAND1_POSITIVE | VcfBatch::STRAND2_POSITIVE);
+    CHECK_EQ(batch.strands[3], 0);
+
+    CHECK_EQ(reader.read_batch(batch, 4), 2);
+    CHECK(std::ranges::all_of(batch.chroms, [](auto const& chrom) { return chrom == "chr17"; }));
+    CHECK(reader.eof());
+
+    CHECK_EQ(reader.read_batch(batch, 4), 0);
+    CHECK(batch.empty());
+  }
+
+  TEST_CASE("test read uncompressed vcf batch") {
+    auto keys = VcfBatchKeys{.end = "SVEND"};
+    auto reader = VcfBatchReader(file_path, keys);
+    auto text_reader = VcfBatchReader("../../test/data/debug_uncom.vcf", keys);
+    auto batch = VcfBatch{};
+    auto text_batch = VcfBatch{};
+
+    CHECK_EQ(reader.read_batch(batch, 8), 6);
+    CHECK_EQ(text_reader.read_batch(text_batch, 8), 6);
+    CHECK(text_reader.eof());
+
+    CHECK_EQ(text_batch.chroms, batch.chroms);
+    CHECK_EQ(text_batch.pos, batch.pos);
+    CHECK_EQ(text_batch.end, batch.end);
+    CHECK_EQ(text_batch.svtypes, batch.svtypes);
+    CHECK_EQ(text_batch.chr2s, batch.chr2s);
+    CHECK_EQ(text_batch.strands, batch.strands);
+  }
+
+  TEST_CASE("test read vcf batch with missing keys") {
+    auto reader = VcfBatchReader(file_path, VcfBatchKeys{.end = "NOT_IN_HEADER"});
+    auto batch = VcfBatch{};
+
+    CHECK_EQ(reader.read_batch(batch, 6), 6);
+    // end of the record is used if the end key is missing
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      CHECK_GE(batch.end[i], batch.pos[i]);
+    }
+  }
+}
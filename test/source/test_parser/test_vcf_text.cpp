@@ -0,0 +1,83 @@
+//
+// Created by li002252 on 10/18/22.
+//
+#include <binary/exception.hpp>
+#include <binary/parser/vcf_text.hpp>
+
+#include "doctest/doctest.h"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+TEST_SUITE("parser-vcf-text") {
+  using namespace binary::parser::vcf;
+  constexpr const char* uncompressed_file_path = "../../test/data/debug_uncom.vcf";
+
+  TEST_CASE("test detect plain vcf") {
+    CHECK(is_plain_vcf(uncompressed_file_path));
+    CHECK_FALSE(is_plain_vcf("../../test/data/debug.vcf.gz"));
+  }
+
+  TEST_CASE("test tokenize plain vcf") {
+    auto reader = VcfTextReader(uncompressed_file_path);
+    auto line = VcfTextLine{};
+
+    std::vector<pos_t> positions{};
+    REQUIRE(reader.next(line));
+    CHECK_EQ(line.chrom, "chr10");
+    CHECK_EQ(line.pos, 93567288 - 1);
+    CHECK_EQ(line.ref, ".");
+    CHECK(line.info.starts_with("CANONICAL;"));
+    positions.push_back(line.pos);
+
+    while (reader.next(line)) positions.push_back(line.pos);
+    CHECK_EQ(positions.size(), 6);
+    CHECK_EQ(line.chrom, "chr17");
+    CHECK(reader.eof());
+    CHECK_FALSE(reader.next(line));
+  }
+
+  TEST_CASE("test find info values") {
+    constexpr std::string_view info = "CANONICAL;SVTYPE=TRA;SVEND=7705262;SV=1";
+    CHECK_EQ(VcfTextReader::find_info(info, "SVTYPE"), "TRA");
+    CHECK_EQ(VcfTextReader::find_info(info, "SV"), "1");
+    CHECK_EQ(VcfTextReader::find_info(info, "SVEND"), "7705262");
+    CHECK_EQ(VcfTextReader::find_info(info, "CANONICAL"), "");
+    CHECK_FALSE(VcfTextReader::find_info(info, "CHR2").has_value());
+    CHECK_FALSE(VcfTextReader::find_info(".", "SVTYPE").has_value());
+  }
+
+  TEST_CASE("test simd info scan matches scalar scan") {
+    // long values like delly's CONSENSUS make keys cross the simd blocks
+    auto info = std::string("PRECISE;SVTYPE=DEL;SVMETHOD=EMBL.DELLYv1.1.6;END=10422;PE=0;MAPQ=0;")
+                + "CT=3to5;CIPOS=-12,12;CIEND=-12,12;SRMAPQ=60;INSLEN=0;HOMLEN=11;SR=3;SRQ=0.98;"
+                + "CONSENSUS=" + std::string(97, 'A') + ";CE=1.9;SVEND=7705262;CHR2=chr17;IMPRECISE";
+
+    for (std::string_view key : {"PRECISE", "SVTYPE", "END", "CIEND", "SRQ", "CONSENSUS", "SVEND",
+                                 "CHR2", "IMPRECISE", "SV", "CE", "E", "MISSING", ";"}) {
+      CHECK_EQ(VcfTextReader::find_info(info, key), VcfTextReader::find_info_scalar(info, key));
+    }
+    CHECK_EQ(VcfTextReader::find_info(info, "END"), "10422");
+    CHECK_EQ(VcfTextReader::find_info(info, "CIEND"), "-12,12");
+    CHECK_EQ(VcfTextReader::find_info(info, "CHR2"), "chr17");
+    CHECK_EQ(VcfTextReader::find_info(info, "IMPRECISE"), "");
+    CHECK_FALSE(VcfTextReader::find_info(info, "SV").has_value());
+  }
+
+  TEST_CASE("test tokenize invalid vcf line") {
+    auto path = std::string("test_vcf_text_invalid.vcf");
+    {
+      auto output = std::ofstream(path);
+      output << "##fileformat=VCFv4.2\nchr1\tnot_a_position\t.\tN\t.\t.\t.\t.\n";
+    }
+
+    auto reader = VcfTextReader(path);
+    auto line = VcfTextLine{};
+    CHECK_THROWS_AS(reader.next(line), binary::VcfReaderError);
+    std::remove(path.c_str());
+  }
+}
@@ -0,0 +1,92 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include <htslib/bgzf.h>
+
+#include "doctest/doctest.h"
+#include "partitions.hpp"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+namespace {
+  using record_key = std::tuple<binary::parser::vcf::pos_t, binary::parser::vcf::pos_t,
+                                std::string, bool, bool>;
+
+  auto record_keys(sv2nl::VcfPartitions::records_type const& records)
+      -> std::vector<record_key> {
+    auto keys = std::vector<record_key>{};
+    for (auto const& record : records) {
+      keys.emplace_back(record.pos, record.info->svend, std::string(record.info->chr2.name()),
+                        record.info->strand1, record.info->strand2);
+    }
+    return keys;
+  }
+
+  auto record_keys(sv2nl::VcfPartitions const& partitions, std::string_view chrom,
+                   std::string_view svtype) -> std::vector<record_key> {
+    return record_keys(partitions.get(chrom, svtype));
+  }
+}  // namespace
+
+TEST_SUITE("sv2nl-partitions") {
+  TEST_CASE("test partitions of plain vcf are read by the text reader") {
+    constexpr const char* file_path = "../../test/data/debug.vcf.gz";
+    constexpr const char* plain_file_path = "test_plain_partitions.vcf";
+    static_assert(sv2nl::Sv2nlVcfRecord::is_text_readable);
+
+    {
+      auto* input = bgzf_open(file_path, "r");
+      REQUIRE(input != nullptr);
+      auto output = std::ofstream(plain_file_path, std::ios::binary);
+      auto buffer = std::vector<char>(1 << 16);
+      for (ssize_t size{}; (size = bgzf_read(input, buffer.data(), buffer.size())) > 0;) {
+        output.write(buffer.data(), size);
+      }
+      bgzf_close(input);
+    }
+
+    // htslib reads the bgzipped file, the text reader reads the same lines
+    auto expected = sv2nl::VcfPartitions::load(sv2nl::Sv2nlVcfRanges{file_path, "nls"});
+    auto partitions = sv2nl::VcfPartitions::load(sv2nl::Sv2nlVcfRanges{plain_file_path, "nls"});
+    REQUIRE_EQ(partitions->size(), expected->size());
+    CHECK_EQ(partitions->chroms(), expected->chroms());
+
+    constexpr std::array svtypes = {"DEL", "INS", "DUP", "TDUP", "INV", "TRA", "BND"};
+    for (auto const& chrom : expected->chroms()) {
+      for (auto const* svtype : svtypes) {
+        CHECK_EQ(record_keys(*partitions, chrom, svtype), record_keys(*expected, chrom, svtype));
+      }
+    }
+    CHECK_FALSE(partitions->get("chr10", "TRA").empty());
+
+    std::filesystem::remove(plain_file_path);
+  }
+
+  TEST_CASE("test records of one svtype of all chromosomes") {
+    constexpr const char* file_path = "../../test/data/debug.vcf.gz";
+    auto partitions = sv2nl::VcfPartitions::load(sv2nl::Sv2nlVcfRanges{file_path, "nls"});
+
+    auto expected = std::vector<record_key>{};
+    for (auto const& chrom : partitions->chroms()) {
+      auto keys = record_keys(*partitions, chrom, "TRA");
+      expected.insert(expected.end(), keys.begin(), keys.end());
+    }
+
+    auto const& records = partitions->get("TRA");
+    auto keys = record_keys(records);
+    CHECK_FALSE(keys.empty());
+    CHECK_EQ(keys, expected);
+
+    // gathered once and shared by later calls
+    CHECK_EQ(&partitions->get("TRA"), &records);
+    CHECK(partitions->get("UNKNOWN").empty());
+  }
+}
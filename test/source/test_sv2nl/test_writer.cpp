@@ -0,0 +1,180 @@
+//
+// Created by li002252 on 10/18/22.
+//
+
+#include "doctest/doctest.h"
+#include "writer.hpp"
+
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <latch>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_END
+
+namespace {
+  /**
+   * @return a key record followed by size records, which are written as size lines
+   */
+  auto make_records(std::string_view chrom, std::size_t first, std::size_t size)
+      -> std::vector<sv2nl::Sv2nlVcfRecord> {
+    auto records = std::vector<sv2nl::Sv2nlVcfRecord>(size + 1);
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      records[i].chrom = binary::parser::vcf::Contig{chrom};
+      records[i].pos = static_cast<binary::parser::vcf::pos_t>(i == 0 ? 0 : first + i);
+      records[i].info->svtype = "DUP";
+      records[i].info->svend = records[i].pos + 1;
+    }
+    return records;
+  }
+
+  auto read_lines(std::string const& file) -> std::vector<std::string> {
+    auto input = std::ifstream(file);
+    auto lines = std::vector<std::string>{};
+    for (std::string line; std::getline(input, line);) lines.push_back(line);
+    return lines;
+  }
+}  // namespace
+
+TEST_SUITE("sv2nl-writer") {
+  using sv2nl::Writer;
+
+  // the leading section and the last section are both more than one flush of the writer
+  constexpr std::array<std::size_t, 4> SECTION_BATCHES{20, 1, 1, 10};
+  constexpr std::size_t BATCH_LINES = 4000;
+
+  auto section_records(std::size_t index, std::size_t batch) {
+    return make_records("chr" + std::to_string(index), batch * BATCH_LINES, BATCH_LINES);
+  }
+
+  /**
+   * @brief section 0 streams while the others are committed from other threads before it
+   */
+  void write_sections(std::string const& file) {
+    auto writer = Writer(file, "header", 4);
+    auto committed = std::latch{SECTION_BATCHES.size() - 1};
+    {
+      auto workers = std::vector<std::jthread>{};
+      workers.emplace_back([&] {
+        auto section = writer.section(0);
+        for (std::size_t batch = 0; batch < SECTION_BATCHES[0]; ++batch) {
+          if (batch == SECTION_BATCHES[0] / 2) committed.wait();
+          section.write(section_records(0, batch));
+        }
+        writer.commit(std::move(section));
+      });
+
+      for (auto index = SECTION_BATCHES.size() - 1; index > 0; --index) {
+        workers.emplace_back([&, index] {
+          auto section = writer.section(index);
+          for (std::size_t batch = 0; batch < SECTION_BATCHES[index]; ++batch) {
+            section.write(section_records(index, batch));
+          }
+          writer.commit(std::move(section));
+          committed.count_down();
+        });
+      }
+    }
+    writer.close();
+  }
+
+  TEST_CASE("test sections are written in the order of indexes") {
+    constexpr const char* file = "test_writer_sections.tsv";
+    write_sections(file);
+
+    auto expected = std::vector<std::string>{"header"};
+    auto section_sizes = std::vector<std::size_t>{};
+    for (std::size_t index = 0; index < SECTION_BATCHES.size(); ++index) {
+      auto size = std::size_t{0};
+      for (std::size_t batch = 0; batch < SECTION_BATCHES[index]; ++batch) {
+        auto records = section_records(index, batch);
+        auto key = Writer::format_keys(records[0]);
+        for (auto iter = std::next(records.begin()); iter != records.end(); ++iter) {
+          expected.push_back(key + '\t' + Writer::format_keys(*iter));
+          size += expected.back().size() + 1;
+        }
+      }
+      section_sizes.push_back(size);
+    }
+    CHECK_GT(section_sizes.front(), Writer::FLUSH_SIZE);
+    CHECK_GT(section_sizes.back(), Writer::FLUSH_SIZE);
+
+    auto lines = read_lines(file);
+    CHECK_EQ(lines.size(), expected.size());
+    CHECK(lines == expected);
+
+    SUBCASE("test output is the same between runs") {
+      constexpr const char* other_file = "test_writer_sections_other.tsv";
+      write_sections(other_file);
+      CHECK(read_lines(other_file) == lines);
+      std::filesystem::remove(other_file);
+    }
+
+    std::filesystem::remove(file);
+  }
+
+  TEST_CASE("test threads switching between writers") {
+    constexpr std::array<const char*, 2> files = {"test_writer_switch_0.tsv",
+                                                  "test_writer_switch_1.tsv"};
+    constexpr std::size_t NUM_THREADS = 4;
+    constexpr std::size_t NUM_LINES = 1000;
+    auto line = [](std::size_t writer, std::size_t thread, std::size_t index) {
+      return fmt::format("{}\t{}\t{}", writer, thread, index);
+    };
+
+    for (int round = 0; round < 2; ++round) {
+      // writers of a round reuse the addresses of the writers of the round before
+      auto writers = std::array<std::unique_ptr<Writer>, 2>{std::make_unique<Writer>(files[0]),
+                                                            std::make_unique<Writer>(files[1])};
+      {
+        auto workers = std::vector<std::jthread>{};
+        for (std::size_t thread = 0; thread < NUM_THREADS; ++thread) {
+          workers.emplace_back([&, thread] {
+            for (std::size_t index = 0; index < NUM_LINES; ++index) {
+              for (std::size_t writer = 0; writer < writers.size(); ++writer) {
+                writers[writer]->write(line(writer, thread, index));
+              }
+            }
+          });
+        }
+      }
+      for (auto& writer : writers) writer->close();
+
+      for (std::size_t writer = 0; writer < writers.size(); ++writer) {
+        auto lines = read_lines(files[writer]);
+        std::ranges::sort(lines);
+        auto expected = std::vector<std::string>{};
+        for (std::size_t thread = 0; thread < NUM_THREADS; ++thread) {
+          for (std::size_t index = 0; index < NUM_LINES; ++index) {
+            expected.push_back(line(writer, thread, index));
+          }
+        }
+        std::ranges::sort(expected);
+        CHECK(lines == expected);
+      }
+    }
+
+    for (auto const* file : files) std::filesystem::remove(file);
+  }
+
+  TEST_CASE("test section committed twice") {
+    constexpr const char* file = "test_writer_twice.tsv";
+    {
+      auto writer = Writer(file);
+      writer.commit(writer.section(0));
+      CHECK_THROWS_AS(writer.commit(writer.section(0)), binary::VcfReaderError);
+
+      // pending sections are committed once as well
+      writer.commit(writer.section(2));
+      CHECK_THROWS_AS(writer.commit(writer.section(2)), binary::VcfReaderError);
+      writer.close();
+    }
+    std::filesystem::remove(file);
+  }
+}
@@ -2,13 +2,21 @@
 // Created by li002252 on 8/29/22.
 //
 
+#include <fcntl.h>
+#include <htslib/bgzf.h>
+#include <htslib/kstring.h>
+#include <unistd.h>
+
 #include "binary/utils.hpp"
 #include "doctest/doctest.h"
 
 DOCTEST_MAKE_STD_HEADERS_CLEAN_FROM_WARNINGS_ON_WALL_BEGIN
+#include <algorithm>
 #include <array>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -20,6 +28,30 @@ void create_file(std::string_view filename, std::string_view content) {
   ofs.close();
 }
 
+// write every part as a separate bgzf block
+void create_bgzf_file(std::string_view filename, std::vector<std::string> const& parts) {
+  auto* output = bgzf_open(filename.data(), "w");
+  REQUIRE(output != nullptr);
+  for (auto const& part : parts) {
+    REQUIRE_EQ(bgzf_write(output, part.data(), part.size()), static_cast<ssize_t>(part.size()));
+    REQUIRE_EQ(bgzf_flush(output), 0);
+  }
+  REQUIRE_EQ(bgzf_close(output), 0);
+}
+
+auto read_bgzf_lines(std::string_view filename) -> std::vector<std::string> {
+  auto* input = bgzf_open(filename.data(), "r");
+  REQUIRE(input != nullptr);
+  CHECK_EQ(bgzf_check_EOF(input), 1);
+
+  auto lines = std::vector<std::string>{};
+  auto line = kstring_t{0, 0, nullptr};
+  while (bgzf_getline(input, '\n', &line) >= 0) lines.emplace_back(line.s, line.l);
+  std::free(line.s);
+  bgzf_close(input);
+  return lines;
+}
+
 TEST_SUITE("test binary utils") {
   TEST_CASE("test merge files") {
     namespace fs = std::filesystem;
@@ -61,6 +93,105 @@ TEST_SUITE("test binary utils") {
     }
   }
 
+  TEST_CASE("test merge files content") {
+    namespace fs = std::filesystem;
+    constexpr std::array files = {"test_part1.txt", "test_part2.txt", "test_part3.txt"};
+    constexpr const char* output_file = "test_merge_content.txt";
+
+    create_file(files[0], "h1\th2\na\t1\nb\t2\n");
+    create_file(files[1], "h1\th2\n");
+    create_file(files[2], "h1\th2\nc\t3");
+
+    binary::utils::merge_files(files, output_file, "h1\th2");
+
+    auto input = std::ifstream(output_file);
+    auto content = std::string(std::istreambuf_iterator<char>(input), {});
+    CHECK_EQ(content, "h1\th2\na\t1\nb\t2\nc\t3");
+    for (auto const& file : files) {
+      CHECK_FALSE(fs::exists(file));
+    }
+    CHECK_NOTHROW(fs::remove(output_file));
+  }
+
+  TEST_CASE("test merge bgzf files") {
+    namespace fs = std::filesystem;
+    constexpr std::array files = {"test_part1.txt.gz", "test_part2.txt.gz", "test_part3.txt.gz",
+                                  "test_part4.txt.gz"};
+    constexpr const char* output_file = "test_merge_content.txt.gz";
+
+    // many blocks after the header
+    auto large_part = std::string{};
+    auto expected = std::vector<std::string>{"h1\th2", "a\t1", "b\t2", "c\t3"};
+    for (auto i = 0; i < 20000; ++i) {
+      expected.push_back("d\t" + std::to_string(i));
+      large_part += expected.back() + '\n';
+    }
+
+    // the header shares its block with lines or has a block of its own
+    create_bgzf_file(files[0], {"h1\th2\na\t1\n"});
+    create_bgzf_file(files[1], {"h1\th2\n", "b\t2\n"});
+    create_bgzf_file(files[2], {"h1\th2\nc\t3\n"});
+    create_bgzf_file(files[3], {"h1\th2\n", large_part});
+
+    SUBCASE("test merge bgzf lines") {
+      binary::utils::merge_files(files, output_file, "h1\th2");
+      CHECK_EQ(read_bgzf_lines(output_file), expected);
+      for (auto const& file : files) {
+        CHECK_FALSE(fs::exists(file));
+      }
+    }
+
+    SUBCASE("test merge bgzf file with header") {
+      expected.erase(expected.begin());
+      binary::utils::merge_files(files, output_file, "", true, false);
+      auto lines = read_bgzf_lines(output_file);
+      CHECK_EQ(std::ranges::count(lines, "h1\th2"), 4);
+      std::erase(lines, "h1\th2");
+      CHECK_EQ(lines, expected);
+    }
+
+    SUBCASE("test merge text file into bgzf file") {
+      create_file(files[2], "h1\th2\nc\t3\n");
+      CHECK_THROWS_AS(binary::utils::merge_files(files, output_file, "h1\th2", false),
+                      std::filesystem::filesystem_error);
+      CHECK_THROWS_AS(
+          binary::utils::merge_files(std::array{files[0]}, "test_merge_content.txt", "h1\th2",
+                                     false),
+          std::filesystem::filesystem_error);
+      fs::remove("test_merge_content.txt");
+      for (auto const& file : files) fs::remove(file);
+    }
+
+    CHECK_NOTHROW(fs::remove(output_file));
+  }
+
+  TEST_CASE("test append part of file") {
+    namespace fs = std::filesystem;
+    constexpr const char* input_file = "test_append_input.txt";
+    constexpr const char* output_file = "test_append_output.txt";
+    create_file(input_file, "0123456789");
+
+    CHECK_EQ(binary::utils::first_line_size(input_file), 10);
+    {
+      auto output = std::ofstream(output_file);
+    }
+    auto output_fd = ::open(output_file, O_WRONLY);
+    REQUIRE(output_fd >= 0);
+    CHECK_EQ(binary::utils::append_file(output_fd, input_file, 2, 3), 3);
+    CHECK_EQ(binary::utils::append_file(output_fd, input_file, 8), 2);
+    CHECK_EQ(binary::utils::append_file(output_fd, input_file, 20), 0);
+    ::close(output_fd);
+
+    auto input = std::ifstream(output_file);
+    auto content = std::string(std::istreambuf_iterator<char>(input), {});
+    CHECK_EQ(content, "23489");
+    CHECK_THROWS_AS(binary::utils::append_file(1, "test_not_exist.txt"),
+                    std::filesystem::filesystem_error);
+
+    fs::remove(input_file);
+    CHECK_NOTHROW(fs::remove(output_file));
+  }
+
   TEST_CASE("test index ranges") {
     std::vector v1{1, 2, 3, 4};
     std::array a1{1, 2, 3, 4};